@@ -0,0 +1,73 @@
+/*
+ * File:   cola-eventos.h
+ * Author: Pablo Caal
+ *
+ * Cola de eventos para dividir la ISR en dos mitades
+ *  Mitad superior: la ISR solo atiende lo crtico en tiempo (SSPBUF) y encola
+ *                  el resto de eventos
+ *  Mitad inferior: el ciclo principal vaca la cola y hace el trabajo diferido
+ *                  (contadores, mapeos, escritura de puertos)
+ *
+ * Un solo productor (ISR) y un solo consumidor (main). Los ndices son de
+ * 8 bits y cada uno lo escribe un solo lado, por lo que no es necesario
+ * deshabilitar interrupciones para encolar o sacar datos.
+ *
+ * Se usan macros en lugar de funciones para no gastar niveles de la pila de
+ * hardware (8 niveles) ni duplicar funciones entre ISR y main.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef COLA_EVENTOS_H
+#define	COLA_EVENTOS_H
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ * CONSTANTES
+ ------------------------------------------------------------------------------*/
+#ifndef COLA_TAMANO
+#define COLA_TAMANO 8           // Nmero de eventos en la cola (potencia de 2)
+#endif
+
+#if (COLA_TAMANO & (COLA_TAMANO - 1)) != 0 || COLA_TAMANO > 128
+#error "COLA_TAMANO debe ser potencia de 2 y menor o igual a 128"
+#endif
+
+#define COLA_MASCARA (COLA_TAMANO - 1)
+
+/*------------------------------------------------------------------------------
+ * TIPOS
+ ------------------------------------------------------------------------------*/
+typedef struct {
+    volatile uint8_t dato[COLA_TAMANO]; // Eventos pendientes
+    volatile uint8_t entrada;           // ndice de escritura (solo ISR)
+    volatile uint8_t salida;            // ndice de lectura (solo main)
+    volatile uint8_t perdidos;          // Eventos descartados por cola llena
+} cola_t;
+
+/*------------------------------------------------------------------------------
+ * MACROS
+ ------------------------------------------------------------------------------*/
+// Hay eventos pendientes? (main)
+#define COLA_VACIA(c)       ((c).entrada == (c).salida)
+
+// Agregar un evento a la cola (solo desde la ISR)
+#define COLA_ENCOLAR(c, v)  do{                                             \
+        uint8_t _sig = (uint8_t)(((c).entrada + 1) & COLA_MASCARA);         \
+        if(_sig != (c).salida){                                             \
+            (c).dato[(c).entrada] = (v);                                    \
+            (c).entrada = _sig;                                             \
+        }                                                                   \
+        else{                                                               \
+            (c).perdidos++;                                                 \
+        }                                                                   \
+    }while(0)
+
+// Sacar el evento ms antiguo de la cola (solo desde main, cola no vaca)
+#define COLA_SACAR(c, v)    do{                                             \
+        (v) = (c).dato[(c).salida];                                         \
+        (c).salida = (uint8_t)(((c).salida + 1) & COLA_MASCARA);            \
+    }while(0)
+
+#endif	/* COLA_EVENTOS_H */
@@ -7,7 +7,7 @@
 
 // CONFIG1
 #pragma config FOSC = INTRC_NOCLKOUT    // Oscillator Selection bits (INTOSCIO oscillator: I/O function on RA6/OSC2/CLKOUT pin, I/O function on RA7/OSC1/CLKIN)
-#pragma config WDTE = OFF               // Watchdog Timer Enable bit (WDT disabled and can be enabled by SWDTEN bit of the WDTCON register)
+#pragma config WDTE = ON                // Watchdog Timer Enable bit (WDT enabled)
 #pragma config PWRTE = OFF              // Power-up Timer Enable bit (PWRT disabled)
 #pragma config MCLRE = OFF              // RE3/MCLR pin function select bit (RE3/MCLR pin function is digital input, MCLR internally tied to VDD)
 #pragma config CP = OFF                 // Code Protection bit (Program memory code protection is disabled)
@@ -30,14 +30,30 @@
 /*------------------------------------------------------------------------------
  * CONSTANTES 
  ------------------------------------------------------------------------------*/
-#define _XTAL_FREQ 1000000      // Frecuencia de oscilador en 1 MHz
-#define FLAG_SPI 0xFF           // Variable bandera para lectura del esclavo
+#include "reloj.h"              // _XTAL_FREQ segn el perfil RELOJ_MHZ
+
+/*------------------------------------------------------------------------------
+ * DESCRIPCION DE PERIFERICOS
+ ------------------------------------------------------------------------------*/
+#define CFG_ROL ROL_MAESTRO
+#define CFG_TRISA 0b00100001        // SS y AN0 como entradas, RA7 -> SS del esclavo
+#define CFG_TRISC 0b00010000        // SDI entrada, SCK y SD0 como salida
+#define CFG_TRISD 0x00              // PORTD como salida
+#define CFG_ANSEL 0b00000001        // AN0 como entrada analgica
+#define CFG_ADC_CANAL 0             // Seleccin de canal AN0
+#define CFG_INTERRUPCIONES INT_ADC
+#define CFG_WDTPS WDTPS_1_4096      // Watchdog de ~132 ms
+#include "perifericos.h"
+#include "spi-maestro.h"
 
 /*------------------------------------------------------------------------------
  * VARIABLES 
  ------------------------------------------------------------------------------*/
 uint8_t LECTURA_POT;            // Valor de lectura del potencimetro (Maestro)
 
+spi_esclavo_t ESCLAVO = SPI_ESCLAVO(0x01, SPI_ESPERA_DEFECTO);  // Estado del esclavo
+uint8_t RESPUESTA;              // Dato recibido del esclavo
+
 /*------------------------------------------------------------------------------
  * PROTOTIPO DE FUNCIONES 
  ------------------------------------------------------------------------------*/
@@ -50,6 +66,9 @@ void __interrupt() isr (void){
     if(PIR1bits.ADIF){                  // Verificacin de interrupcin del mdulo ADC
         if(ADCON0bits.CHS == 0){        // Verificacin de canal AN0
             LECTURA_POT = ADRESH;       // Almacenar el resgitro ADRESH en variable LECTURA_POT
+            if(LECTURA_POT == SPI_LEER){
+                LECTURA_POT = SPI_LEER - 1; // 0xFF queda reservado para pedir el contador
+            }
         }
         PIR1bits.ADIF = 0;              // Limpieza de bandera de interrupcin
     } 
@@ -62,24 +81,28 @@ void __interrupt() isr (void){
 void main(void) {
     setup();
     while(1){
+        CLRWDT();                   // Servicio del watchdog una vez por ciclo
         // Activacin del proceso de conversin del mdulo ADC
         if(ADCON0bits.GO == 0){     // Si no hay proceso de conversin
             __delay_us(40);
             ADCON0bits.GO = 1;      // Ejecucin de proceso de conversin
         }
         
-        // Envo de valor al esclavo
-        SSPBUF = LECTURA_POT;       // Cargamos valor del potencimetro al buffer
-        while(!SSPSTATbits.BF){}    // Esperamos a que termine el envio
-        
-        // Cambio en el selector (SS) para generar respuesta del pic
-        PORTAbits.RA7 = 1;          // Deshabilitamos el ss del esclavo
-        __delay_ms(10);             // Delay para que el PIC pueda detectar el cambio en el pin
-        PORTAbits.RA7 = 0;          // habilitamos nuevamente el escalvo
-
-        SSPBUF = FLAG_SPI;          // Master inicia la comunicacin y prende el clock
-        while(!SSPSTATbits.BF){}    // Esperamos a que se reciba un dato
-        PORTD = SSPBUF;             // Mostramos dato recibido en PORTD
+        // Si el esclavo est cado se omite sin detener el ciclo
+        if(spi_disponible(&ESCLAVO)){
+            // Envo de valor al esclavo (la salud la decide la lectura verificada)
+            spi_byte(&ESCLAVO, LECTURA_POT, &RESPUESTA);
+            
+            // Cambio en el selector (SS) para generar respuesta del pic
+            PORTAbits.RA7 = 1;          // Deshabilitamos el ss del esclavo
+            _delay(SPI_GUARDA_SS_CICLOS); // Delay para que el PIC pueda detectar el cambio en el pin
+            PORTAbits.RA7 = 0;          // habilitamos nuevamente el escalvo
+            
+            if(spi_leer(&ESCLAVO, &RESPUESTA) == SPI_OK){
+                PORTD = RESPUESTA;      // Mostramos el contador solo si la respuesta es vlida
+            }
+            _delay(SPI_LATENCIA_ESCLAVO_CICLOS);    // El esclavo lee SPI_VERIFICAR antes del siguiente dato (sin SSPOV)
+        }
     }
     return;
 }
@@ -88,45 +111,33 @@ void main(void) {
  * CONFIGURACION 
  ------------------------------------------------------------------------------*/
 void setup(void){       
-    // Configuracin del oscilador interno
-    OSCCONbits.IRCF = 0b100;    // 1MHz
-    OSCCONbits.SCS = 1;         // Reloj interno
+    // Banco 0: limpieza de puertos antes de habilitar salidas
+    PORTA = 0x00;                       // Limpieza del PORTA
+    PORTC = 0x00;                       // Limpieza del PORTC
+    PORTD = 0x00;                       // Limpieza del PORTD
     
-    // Configuracin de puertos
-    ANSEL = 0b001;              // AN0 como entrada analgicas
-    ANSELH = 0x00;              // I/O digitales
-        
-    TRISA = 0b00100001;         // SS y AN0 como entradas
-                                // RA7 se conectar al SS (RA5) del esclavo
-    TRISC = 0b00010000;         // SDI entrada, SCK y SD0 como salida
-    TRISD = 0x00;               // PORTD como salida
-    PORTA = 0x00;               // Limpieza del PORTA
-    PORTC = 0x00;               // Limpieza del PORTC
-    PORTD = 0x00;               // Limpieza del PORTD
+    // Banco 2: periodo del watchdog
+    WDTCON = CFG_WDTCON_VALOR;          // WDT 1:4096 (~132 ms)
     
-    // Configuracin de interrucpiones
-    PIR1bits.ADIF = 0;          // Limpiamos bandera de ADC
-    PIE1bits.ADIE = 1;          // Habilitamos interrupcion de ADC
-    INTCONbits.PEIE = 1;        // Habilitamos interrupciones de perifericos
-    INTCONbits.GIE = 1;         // Habilitamos interrupciones globales
+    // Banco 1: oscilador, puertos, SPI y ADC
+    OSCCON = CFG_OSCCON_VALOR;          // RELOJ_MHZ, reloj interno
+    TRISA = CFG_TRISA;
+    OPTION_REG = CFG_OPTION_REG_VALOR;  // Postscaler 1:1 asignado al WDT
+    TRISC = CFG_TRISC;
+    TRISD = CFG_TRISD;
+    SSPSTAT = CFG_SSPSTAT_VALOR;        // CKE = 1, SMP = 1 (dato al final del pulso de reloj)
+    ADCON1 = CFG_ADCON1_VALOR;          // VDD/VSS, justificado a la izquierda
+    PIE1 = CFG_PIE1_VALOR;              // Habilitamos interrupcion de ADC
     
-    // Configuracin ADC
-    ADCON0bits.ADCS = 0b01;         // Fosc/8
-    ADCON1bits.VCFG0 = 0;           // VDD
-    ADCON1bits.VCFG1 = 0;           // VSS
-    ADCON0bits.CHS = 0b0000;        // Seleccin de canal AN0
-    ADCON1bits.ADFM = 0;            // Configuracin de justificado a la izquierda
-    ADCON0bits.ADON = 1;            // Habilitacin del modulo ADC
-    __delay_us(40);                 // Display de sample time
-        
-    // Configuracin de SPI    
-    // Configuracin del MAESTRO    
-    // SSPCON<5:0>
-    SSPCONbits.SSPM = 0b0000;   // SPI Maestro, Reloj -> Fosc/4 (250kbits/s)
-    SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-    SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI (Para que no los utilice como RPG)
-    // SSPSTAT<7:6>
-    SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-    SSPSTATbits.SMP = 1;        // Dato al final del pulso de reloj
-    SSPBUF = LECTURA_POT;       // Enviamos un dato inicial (valor inicial de la variable)
-}
\ No newline at end of file
+    // Banco 3: entradas analgicas
+    ANSEL = CFG_ANSEL;
+    ANSELH = CFG_ANSELH;
+    
+    // Banco 0: habilitacin de perifricos
+    ADCON0 = CFG_ADCON0_VALOR;          // TAD segn el perfil, AN0, modulo ADC encendido
+    __delay_us(40);                     // Display de sample time
+    SSPCON = CFG_SSPCON_VALOR;          // SPI Maestro, reloj inactivo en 0
+    PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+    SSPBUF = LECTURA_POT;               // Enviamos un dato inicial (valor inicial de la variable)
+    INTCON = CFG_INTCON_VALOR;          // GIE y PEIE al final
+}
@@ -0,0 +1,316 @@
+/*
+ * File:   perifericos.h
+ * Author: Pablo Caal
+ *
+ * Configuracin declarativa de perifricos para el PIC16F887
+ *  Cada programa describe su rol y sus pines con macros CFG_* antes de
+ *  incluir este archivo. Aqu se generan en tiempo de compilacin los valores
+ *  completos de cada registro (CFG_*_VALOR) para que setup() los escriba de
+ *  una sola vez, agrupados por banco, en lugar de bit por bit.
+ *
+ *  Tambin se verifica en tiempo de compilacin que los pines del SSP en
+ *  TRISC (y el SS en TRISA/ANSEL) coincidan con el rol SPI declarado.
+ *
+ *  Los valores que dependen del reloj (IRCF, ADCS, divisor SPI y trama del
+ *  servo) se derivan del perfil RELOJ_MHZ de reloj.h y se verifican contra
+ *  los lmites del datasheet.
+ *
+ * Descripcin que debe dar cada programa:
+ *  CFG_ROL                 ROL_MAESTRO, ROL_ESCLAVO o ROL_CONMUTABLE
+ *  CFG_TRISA..CFG_TRISD    Direccin de los puertos
+ *  CFG_TRISC               Solo para ROL_MAESTRO y ROL_ESCLAVO
+ *  Opcionales:
+ *  CFG_ANSEL, CFG_ANSELH   Entradas analgicas (0 por defecto)
+ *  CFG_INTERRUPCIONES      Suma de INT_ADC, INT_SSP, INT_CCP1, INT_RB
+ *  CFG_PULLUPS_B           Pull-ups de PORTB (WPUB)
+ *  CFG_IOC_B               Interrupcin por cambio de PORTB (IOCB)
+ *  CFG_SPI_DIV             Reloj SPI del maestro (por defecto el ms rpido
+ *                          que no pase de SPI_FRECUENCIA_MAX)
+ *  CFG_ADC_CANAL           Canal del ADC (sin definir -> ADC apagado)
+ *  CFG_ADC_ADCS            Reloj de conversin (por defecto el ms rpido
+ *                          con TAD >= TAD_MIN_NS)
+ *  CFG_ADC_ADFM            1 -> resultado de 10 bits justificado a la derecha
+ *                          (ADRESH:ADRESL), 0 -> 8 bits en ADRESH (por defecto)
+ *  CFG_SERVO_TRAMA_US      Periodo de la seal de servo en CCP1 por comparacin
+ *                          con TMR1 (sin definir -> TMR1 apagado)
+ *  CFG_WDTPS               Prescaler del watchdog (requiere WDTE = ON), el
+ *                          postscaler de OPTION_REG queda en 1:1 para el WDT
+ *  ROL_CONMUTABLE (el rol se decide en tiempo de ejecucin):
+ *  CFG_TRISC_MAESTRO, CFG_TRISC_ESCLAVO, CFG_ANSEL_MAESTRO, CFG_ANSEL_ESCLAVO,
+ *  CFG_INTERRUPCIONES_MAESTRO, CFG_INTERRUPCIONES_ESCLAVO
+ *
+ * Orden de escritura recomendado en setup():
+ *  Banco 0 (PORTx) -> Banco 1 (OSCCON, TRISx, SSPSTAT, ADCON1, ...) ->
+ *  Banco 3 (ANSEL) -> Banco 0 (ADCON0, T1CON, CCP1CON, SSPCON, PIR1) ->
+ *  INTCON (GIE) al final, cuando todos los perifricos ya estn configurados
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef PERIFERICOS_H
+#define	PERIFERICOS_H
+
+#include "reloj.h"
+
+/*------------------------------------------------------------------------------
+ * CONSTANTES
+ ------------------------------------------------------------------------------*/
+// Roles SPI
+#define ROL_MAESTRO 1
+#define ROL_ESCLAVO 2
+#define ROL_CONMUTABLE 3            // Maestro o esclavo segn un pin al arrancar
+
+// Interrupciones (byte bajo = bits de PIE1)
+#define INT_CCP1 (1 << 2)           // PIE1.CCP1IE
+#define INT_SSP (1 << 3)            // PIE1.SSPIE
+#define INT_ADC (1 << 6)            // PIE1.ADIE
+#define INT_RB 0x100                // INTCON.RBIE
+
+// OSCCON
+#define IRCF_1MHZ 0b100
+#define IRCF_4MHZ 0b110
+#define IRCF_8MHZ 0b111
+#define OSCCON_SCS 0x01             // Reloj interno
+
+// SSPCON / SSPSTAT
+#define SSPM_MAESTRO_FOSC_4 0b0000
+#define SSPM_MAESTRO_FOSC_16 0b0001
+#define SSPM_MAESTRO_FOSC_64 0b0010
+#define SSPM_ESCLAVO_SS 0b0100      // SPI esclavo, SS habilitado
+#define SPI_SCK_MEDIO_MIN_NS (TOSC_A_NS(4) + 20)    // SCK alto y bajo mnimos del esclavo (mismo reloj): Tcy + 20 ns
+#define SPI_FRECUENCIA_MAX (1000000000UL / (2 * SPI_SCK_MEDIO_MIN_NS))  // SCK mximo (Fosc/16 en los tres perfiles)
+#define SSPCON_SSPEN (1 << 5)
+#define SSPCON_CKP (1 << 4)         // Reloj inactivo en 1 (no se usa)
+#define SSPSTAT_SMP (1 << 7)        // Muestreo al final del pulso (solo maestro)
+#define SSPSTAT_CKE (1 << 6)        // Dato enviado cada flanco de subida
+
+// Pines del SSP en PORTC
+#define TRISC_SCK (1 << 3)
+#define TRISC_SDI (1 << 4)
+#define TRISC_SDO (1 << 5)
+#define TRISC_CCP1 (1 << 2)
+#define TRISA_SS (1 << 5)
+#define ANSEL_SS (1 << 4)           // AN4 comparte pin con SS (RA5)
+
+// ADC
+#define ADCS_FOSC_2 0b00
+#define ADCS_FOSC_8 0b01
+#define ADCS_FOSC_32 0b10
+#define TAD_MIN_NS 1600             // TAD mnimo del datasheet
+#define ADCON0_ADON 0x01
+#define ADCON1_ADFM (1 << 7)        // Justificado a la derecha
+
+// TMR1 / CCP1 (comparacin)
+#define T1CON_TMR1ON 0x01           // Fosc/4, prescaler 1:1
+#define CCP1M_COMPARA_ALTO 0b1000   // CCP1 pasa a 1 al coincidir con TMR1
+#define CCP1M_COMPARA_BAJO 0b1001   // CCP1 pasa a 0 al coincidir con TMR1
+
+// INTCON / OPTION_REG
+#define INTCON_GIE (1 << 7)
+#define INTCON_PEIE (1 << 6)
+#define INTCON_RBIE (1 << 3)
+#define OPTION_REG_RESET 0xFF
+#define OPTION_REG_nRBPU (1 << 7)
+#define OPTION_REG_PS 0b00000111    // Postscaler compartido TMR0/WDT
+
+// WDTCON: periodo del WDT = 2^(5 + WDTPS) / 31 kHz
+#define WDTPS_1_1024 0b0101         // ~33 ms
+#define WDTPS_1_2048 0b0110         // ~66 ms
+#define WDTPS_1_4096 0b0111         // ~132 ms
+#define WDTPS_1_8192 0b1000         // ~264 ms
+
+/*------------------------------------------------------------------------------
+ * VALORES POR DEFECTO DE LA DESCRIPCIN
+ ------------------------------------------------------------------------------*/
+#ifndef CFG_ROL
+#error "Defina CFG_ROL antes de incluir perifericos.h"
+#endif
+#ifndef CFG_IRCF
+    #if RELOJ_MHZ == 8
+    #define CFG_IRCF IRCF_8MHZ
+    #elif RELOJ_MHZ == 4
+    #define CFG_IRCF IRCF_4MHZ
+    #else
+    #define CFG_IRCF IRCF_1MHZ
+    #endif
+#endif
+#ifndef CFG_ANSEL
+#define CFG_ANSEL 0x00
+#endif
+#ifndef CFG_ANSELH
+#define CFG_ANSELH 0x00
+#endif
+#ifndef CFG_TRISB
+#define CFG_TRISB 0xFF
+#endif
+#ifndef CFG_INTERRUPCIONES
+#define CFG_INTERRUPCIONES 0
+#endif
+#ifndef CFG_PULLUPS_B
+#define CFG_PULLUPS_B 0x00
+#endif
+#ifndef CFG_IOC_B
+#define CFG_IOC_B 0x00
+#endif
+#ifndef CFG_SPI_DIV
+    #if _XTAL_FREQ / 4 <= SPI_FRECUENCIA_MAX
+    #define CFG_SPI_DIV SSPM_MAESTRO_FOSC_4
+    #elif _XTAL_FREQ / 16 <= SPI_FRECUENCIA_MAX
+    #define CFG_SPI_DIV SSPM_MAESTRO_FOSC_16
+    #else
+    #define CFG_SPI_DIV SSPM_MAESTRO_FOSC_64
+    #endif
+#endif
+#ifndef CFG_ADC_ADCS
+    #if TOSC_A_NS(2) >= TAD_MIN_NS
+    #define CFG_ADC_ADCS ADCS_FOSC_2
+    #elif TOSC_A_NS(8) >= TAD_MIN_NS
+    #define CFG_ADC_ADCS ADCS_FOSC_8
+    #else
+    #define CFG_ADC_ADCS ADCS_FOSC_32
+    #endif
+#endif
+#ifndef CFG_ADC_ADFM
+#define CFG_ADC_ADFM 0
+#endif
+
+/*------------------------------------------------------------------------------
+ * MACROS GENERADORAS
+ ------------------------------------------------------------------------------*/
+// Valor de PIE1 e INTCON para un conjunto de interrupciones
+#define PIE1_DE(i)      ((i) & 0xFF)
+#define INTCON_DE(i)    (INTCON_GIE | (((i) & 0xFF) ? INTCON_PEIE : 0) | \
+                        (((i) & INT_RB) ? INTCON_RBIE : 0))
+
+// Los pines del SSP en TRISC son correctos para el rol?
+//  Maestro: SCK y SDO salidas, SDI entrada
+//  Esclavo: SCK y SDI entradas (SDO puede quedar como entrada si solo recibe)
+#define TRISC_SSP_VALIDO(rol, trisc) \
+    ((rol) == ROL_MAESTRO ? \
+        (((trisc) & (TRISC_SCK | TRISC_SDI | TRISC_SDO)) == TRISC_SDI) : \
+        (((trisc) & (TRISC_SCK | TRISC_SDI)) == (TRISC_SCK | TRISC_SDI)))
+
+// Divisores de Fosc del reloj SPI del maestro y del reloj de conversin
+#define SPI_DIVISOR_DE(sspm)    ((sspm) == SSPM_MAESTRO_FOSC_4 ? 4 : (sspm) == SSPM_MAESTRO_FOSC_16 ? 16 : 64)
+#define ADCS_DIVISOR_DE(adcs)   ((adcs) == ADCS_FOSC_2 ? 2 : (adcs) == ADCS_FOSC_8 ? 8 : 32)
+
+// Las entradas analgicas AN0-AN4 son entradas en TRISA?
+#define ANSEL_TRISA(ansel)  ((((ansel) & 0x0F)) | (((ansel) & ANSEL_SS) ? TRISA_SS : 0))
+#define ANSEL_VALIDO(ansel, trisa)  ((ANSEL_TRISA(ansel) & ~(trisa)) == 0)
+
+/*------------------------------------------------------------------------------
+ * VERIFICACIONES EN TIEMPO DE COMPILACIN
+ ------------------------------------------------------------------------------*/
+#if CFG_ROL == ROL_CONMUTABLE
+    #if !TRISC_SSP_VALIDO(ROL_MAESTRO, CFG_TRISC_MAESTRO)
+    #error "CFG_TRISC_MAESTRO: SCK/SDO deben ser salidas y SDI entrada"
+    #endif
+    #if !TRISC_SSP_VALIDO(ROL_ESCLAVO, CFG_TRISC_ESCLAVO)
+    #error "CFG_TRISC_ESCLAVO: SCK y SDI deben ser entradas"
+    #endif
+    #if !ANSEL_VALIDO(CFG_ANSEL_MAESTRO, CFG_TRISA) || !ANSEL_VALIDO(CFG_ANSEL_ESCLAVO, CFG_TRISA)
+    #error "Hay entradas analgicas configuradas como salida en TRISA"
+    #endif
+    #if (CFG_ANSEL_ESCLAVO & ANSEL_SS) || !(CFG_TRISA & TRISA_SS)
+    #error "El esclavo necesita SS (RA5) como entrada digital"
+    #endif
+#elif CFG_ROL == ROL_MAESTRO || CFG_ROL == ROL_ESCLAVO
+    #if !TRISC_SSP_VALIDO(CFG_ROL, CFG_TRISC)
+    #error "CFG_TRISC no coincide con los pines del SSP para el rol SPI"
+    #endif
+    #if !ANSEL_VALIDO(CFG_ANSEL, CFG_TRISA)
+    #error "Hay entradas analgicas configuradas como salida en TRISA"
+    #endif
+    #if CFG_ROL == ROL_ESCLAVO && ((CFG_ANSEL & ANSEL_SS) || !(CFG_TRISA & TRISA_SS))
+    #error "El esclavo necesita SS (RA5) como entrada digital"
+    #endif
+    #if CFG_ROL == ROL_MAESTRO && ((CFG_INTERRUPCIONES) & INT_SSP)
+    #error "El maestro espera BF por encuesta, no usa INT_SSP"
+    #endif
+#else
+    #error "CFG_ROL debe ser ROL_MAESTRO, ROL_ESCLAVO o ROL_CONMUTABLE"
+#endif
+
+#if ((CFG_INTERRUPCIONES) & INT_RB) && (CFG_IOC_B == 0)
+#error "INT_RB requiere pines en CFG_IOC_B"
+#endif
+#if (CFG_IOC_B & ~CFG_TRISB) != 0
+#error "Los pines de CFG_IOC_B deben ser entradas en TRISB"
+#endif
+
+#ifdef CFG_ADC_CANAL
+    #if CFG_ADC_CANAL > 7 || !((CFG_ANSEL | CFG_ANSEL_MAESTRO) & (1 << CFG_ADC_CANAL))
+    #error "El canal del ADC debe estar habilitado como analgico en ANSEL"
+    #endif
+#elif ((CFG_INTERRUPCIONES) & INT_ADC)
+    #error "INT_ADC requiere CFG_ADC_CANAL"
+#endif
+
+#if CFG_ROL != ROL_ESCLAVO && _XTAL_FREQ / SPI_DIVISOR_DE(CFG_SPI_DIV) > SPI_FRECUENCIA_MAX
+#error "CFG_SPI_DIV: el reloj SPI excede SPI_FRECUENCIA_MAX para este perfil de reloj"
+#endif
+#if defined(CFG_ADC_CANAL) && TOSC_A_NS(ADCS_DIVISOR_DE(CFG_ADC_ADCS)) < TAD_MIN_NS
+#error "CFG_ADC_ADCS: TAD menor al mnimo de 1.6 us para este perfil de reloj"
+#endif
+
+#ifdef CFG_SERVO_TRAMA_US
+    #if US_A_CICLOS(CFG_SERVO_TRAMA_US) > 0xFFFF
+    #error "CFG_SERVO_TRAMA_US no cabe en TMR1 (16 bits) con este perfil de reloj"
+    #endif
+    #if (CFG_SERVO_TRAMA_US * RELOJ_MHZ) % 4 != 0
+    #error "CFG_SERVO_TRAMA_US no es un nmero exacto de ciclos de TMR1"
+    #endif
+#elif ((CFG_INTERRUPCIONES) & INT_CCP1)
+    #error "INT_CCP1 requiere CFG_SERVO_TRAMA_US"
+#endif
+
+#if defined(CFG_WDTPS) && CFG_WDTPS > 0b1011
+#error "CFG_WDTPS fuera de rango (0b0000 - 0b1011)"
+#endif
+
+/*------------------------------------------------------------------------------
+ * VALORES DE REGISTRO GENERADOS
+ ------------------------------------------------------------------------------*/
+#define CFG_OSCCON_VALOR ((CFG_IRCF << 4) | OSCCON_SCS)
+#define CFG_OPTION_REG_PULLUPS (CFG_PULLUPS_B ? (OPTION_REG_RESET & ~OPTION_REG_nRBPU) : OPTION_REG_RESET)
+#ifdef CFG_WDTPS
+#define CFG_OPTION_REG_VALOR (CFG_OPTION_REG_PULLUPS & ~OPTION_REG_PS)  // PSA = 1, WDT 1:1
+#define CFG_WDTCON_VALOR (CFG_WDTPS << 1)
+#else
+#define CFG_OPTION_REG_VALOR CFG_OPTION_REG_PULLUPS
+#endif
+#define CFG_WPUB_VALOR CFG_PULLUPS_B
+#define CFG_IOCB_VALOR CFG_IOC_B
+
+// SSP por rol: CKP = 0, CKE = 1 en ambos; SMP = 1 solo en el maestro
+// (el esclavo siempre debe tener SMP = 0)
+#define SPI_DIVISOR SPI_DIVISOR_DE(CFG_SPI_DIV)
+#define SSPCON_MAESTRO_VALOR (SSPCON_SSPEN | CFG_SPI_DIV)
+#define SSPSTAT_MAESTRO_VALOR (SSPSTAT_SMP | SSPSTAT_CKE)
+#define SSPCON_ESCLAVO_VALOR (SSPCON_SSPEN | SSPM_ESCLAVO_SS)
+#define SSPSTAT_ESCLAVO_VALOR (SSPSTAT_CKE)
+
+#if CFG_ROL == ROL_MAESTRO
+#define CFG_SSPCON_VALOR SSPCON_MAESTRO_VALOR
+#define CFG_SSPSTAT_VALOR SSPSTAT_MAESTRO_VALOR
+#elif CFG_ROL == ROL_ESCLAVO
+#define CFG_SSPCON_VALOR SSPCON_ESCLAVO_VALOR
+#define CFG_SSPSTAT_VALOR SSPSTAT_ESCLAVO_VALOR
+#endif
+
+#define CFG_PIE1_VALOR PIE1_DE(CFG_INTERRUPCIONES)
+#define CFG_INTCON_VALOR INTCON_DE(CFG_INTERRUPCIONES)
+
+// ADC: VDD/VSS como referencias, justificado segn CFG_ADC_ADFM
+#ifdef CFG_ADC_CANAL
+#define CFG_ADCON0_VALOR ((CFG_ADC_ADCS << 6) | (CFG_ADC_CANAL << 2) | ADCON0_ADON)
+#define CFG_ADCON1_VALOR (CFG_ADC_ADFM ? ADCON1_ADFM : 0x00)
+#endif
+
+// Trama del servo: TMR1 libre a Fosc/4, CCP1 programa cada flanco por comparacin
+#ifdef CFG_SERVO_TRAMA_US
+#define CFG_SERVO_TRAMA_CICLOS US_A_CICLOS(CFG_SERVO_TRAMA_US)
+#define CFG_T1CON_VALOR T1CON_TMR1ON
+#endif
+
+#endif	/* PERIFERICOS_H */
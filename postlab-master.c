@@ -4,7 +4,9 @@
  * 
  * MUC 1 - master del postlaboratorio 11 
  *  Entrada: Control de una seal de potencimetro (AN0/RA0) enviado al MCU2
+ *           con la resolucin de SERVO_RESOLUCION (servo-protocolo.h)
  *  Salida: Contador de 8 bits proveniente del MCU3 (PORTD)
+ *  Salida: Posicin real del servo reportada por el MCU2 en lazo cerrado (PORTB)
  *  
  * 
  * Created on 11 de mayo de 2022, 02:09 PM
@@ -12,7 +14,7 @@
 
 // CONFIG1
 #pragma config FOSC = INTRC_NOCLKOUT    // Oscillator Selection bits (INTOSCIO oscillator: I/O function on RA6/OSC2/CLKOUT pin, I/O function on RA7/OSC1/CLKIN)
-#pragma config WDTE = OFF               // Watchdog Timer Enable bit (WDT disabled and can be enabled by SWDTEN bit of the WDTCON register)
+#pragma config WDTE = ON                // Watchdog Timer Enable bit (WDT enabled)
 #pragma config PWRTE = OFF              // Power-up Timer Enable bit (PWRT disabled)
 #pragma config MCLRE = OFF              // RE3/MCLR pin function select bit (RE3/MCLR pin function is digital input, MCLR internally tied to VDD)
 #pragma config CP = OFF                 // Code Protection bit (Program memory code protection is disabled)
@@ -31,22 +33,98 @@
 
 #include <xc.h>
 #include <stdint.h>
+#include "servo-protocolo.h"
 
 /*------------------------------------------------------------------------------
  * CONSTANTES 
  ------------------------------------------------------------------------------*/
-#define _XTAL_FREQ 1000000      // Frecuencia de oscilador en 1 MHz
-#define FLAG_SPI 0xFF           // Variable bandera para lectura del esclavo
+#include "reloj.h"              // _XTAL_FREQ segn el perfil RELOJ_MHZ
+
+// Filtro digital de la lectura del potencimetro (mediana + IIR)
+//  Latencia agregada: (FILTRO_MEDIANA-1)/2 muestras por la mediana y una
+//  constante de tiempo de 2^FILTRO_IIR_K muestras por el IIR. Con 3 muestras,
+//  K = 2 y una muestra por ciclo (~10 ms) son ~10 ms + ~40 ms. Un escaln
+//  llega a 1 LSB (8 bits) del final en 17-19 muestras (pruebas/prueba-filtro.c).
+#define FILTRO_MEDIANA 3        // Muestras de la mediana (3 o 5)
+#define FILTRO_IIR_K 2          // Coeficiente del IIR: y += (x - y)/2^K
+#define FILTRO_UMBRAL 2         // Cambio mnimo del valor filtrado para enviarlo al esclavo 1 (LSB de SERVO_RESOLUCION)
+#define ENVIO_PERIODO 50        // Ciclos sin envo tras los que se reenva la posicin (~0.5 s a 1 MHz)
+                                // aunque no cambie: repite una actualizacin perdida y refresca POSICION_SERVO
+
+#if FILTRO_MEDIANA != 3 && FILTRO_MEDIANA != 5
+#error "FILTRO_MEDIANA debe ser 3 o 5"
+#endif
+#if FILTRO_IIR_K + SERVO_RESOLUCION > 16
+#error "FILTRO_IIR_K + SERVO_RESOLUCION debe ser menor o igual a 16 (acumulador de 16 bits)"
+#endif
+
+// Costo de cada resolucin por actualizacin enviada al esclavo 1 (perfil de 1 MHz,
+// SPI a Fosc/16; a 4 y 8 MHz todo es 4 y 8 veces ms rpido):
+//   8 bits: 1 conversin, 1 byte (~128 us de SPI)
+//  10 bits: 1 conversin, 2 bytes + SERVO_PAUSA_CICLOS (~1.3 ms de SPI)
+//  12 bits: 16 conversiones encadenadas en la ISR (~2 ms), 2 bytes + SERVO_PAUSA_CICLOS
+//  Un umbral de 2 LSB es ms fino en 10 y 12 bits, por lo que se enva ms seguido.
+
+/*------------------------------------------------------------------------------
+ * DESCRIPCION DE PERIFERICOS
+ ------------------------------------------------------------------------------*/
+#define CFG_ROL ROL_MAESTRO
+#define CFG_TRISA 0b00000001        // AN0 como entrada, RA6 -> SS1 y RA7 -> SS2 (en alto fuera de cada transferencia)
+#define CFG_TRISB 0x00              // PORTB como salida
+#define CFG_TRISC 0b00010000        // SDI entrada, SCK y SD0 como salida
+#define CFG_TRISD 0x00              // PORTD como salida
+#define CFG_ANSEL 0b00000001        // AN0 como entrada analgica
+#define CFG_ADC_CANAL 0             // Seleccin de canal AN0
+#define CFG_ADC_ADFM (SERVO_RESOLUCION > 8) // ADRESH:ADRESL justificado a la derecha en alta resolucin
+#define CFG_INTERRUPCIONES INT_ADC
+#define CFG_WDTPS WDTPS_1_4096      // Watchdog de ~132 ms
+#include "perifericos.h"
+#include "spi-maestro.h"
+
+#if SERVO_BYTES == 2 && SERVO_LATENCIA_ISR_CICLOS <= 2 * SPI_DIVISOR
+#error "SERVO_LATENCIA_ISR_CICLOS debe ser mayor que un byte SPI (2 * SPI_DIVISOR ciclos)"
+#endif
 
 /*------------------------------------------------------------------------------
  * VARIABLES 
  ------------------------------------------------------------------------------*/
-uint8_t LECTURA_POT;            // Valor de lectura del potencimetro (Maestro)
+servo_t LECTURA_POT;            // Valor filtrado del potencimetro (Maestro)
+volatile servo_t MUESTRA;       // Lectura cruda del ADC (ADRESH, ADRESH:ADRESL o suma sobremuestreada)
+volatile uint8_t MUESTRA_NUEVA; // Bandera de lectura cruda pendiente de filtrar
+#if SERVO_RESOLUCION == 12
+uint16_t SOBREMUESTREO_SUMA;    // Suma de las conversiones de 10 bits
+uint8_t SOBREMUESTREO_CUENTA;   // Conversiones acumuladas
+#endif
+servo_t VENTANA[FILTRO_MEDIANA];    // ltimas muestras para la mediana
+uint8_t VENTANA_INDICE;         // Posicin de la siguiente muestra en la ventana
+uint16_t IIR_ACUM;              // Acumulador del IIR (valor filtrado * 2^K)
+servo_t ULTIMO_ENVIADO;         // ltimo valor enviado al esclavo 1
+servo_t DIFERENCIA;             // Cambio del valor filtrado respecto al ltimo envo
+uint8_t FILTRO_LISTO;           // Bandera de filtro inicializado con la primera muestra (antes no se enva)
+uint8_t ENVIO_PENDIENTE;        // Bandera de transferencia programada al esclavo 1
+uint8_t ENVIO_CUENTA;           // Ciclos desde el ltimo envo exitoso al esclavo 1
+uint16_t TX_ENVIADOS;           // Transferencias realizadas al esclavo 1
+uint16_t TX_OMITIDOS;           // Muestras nuevas que no superaron el umbral de cambio
+uint8_t POSICION_SERVO;         // Posicin real del servo (respuesta del esclavo 1 en lazo cerrado)
+#if !LAZO_CERRADO
+uint8_t ULTIMO_BYTE_1;          // ltimo byte enviado al esclavo 1 (eco esperado)
+uint8_t ECO_CONOCIDO;           // Bandera de ULTIMO_BYTE_1 vlido (tras un reinicio el eco es desconocido)
+#endif
+
+spi_esclavo_t ESCLAVO_1 = SPI_ESCLAVO(0x01, SPI_ESPERA_DEFECTO);    // Estado del esclavo 1 (servo)
+spi_esclavo_t ESCLAVO_2 = SPI_ESCLAVO(0x02, SPI_ESPERA_DEFECTO);    // Estado del esclavo 2 (contador)
+uint8_t RESPUESTA;              // Dato recibido del esclavo 2
 
 /*------------------------------------------------------------------------------
  * PROTOTIPO DE FUNCIONES 
  ------------------------------------------------------------------------------*/
 void setup(void);
+servo_t leer_muestra(void);
+servo_t sembrar_filtro(servo_t muestra);
+servo_t mediana(servo_t muestra);
+servo_t filtro_iir(servo_t muestra);
+uint8_t enviar_byte(uint8_t dato);
+uint8_t enviar_posicion(servo_t valor);
 
 /*------------------------------------------------------------------------------
  * INTERRUPCIONES 
@@ -54,7 +132,24 @@ void setup(void);
 void __interrupt() isr (void){
     if(PIR1bits.ADIF){                  // Verificacin de interrupcin del mdulo ADC
         if(ADCON0bits.CHS == 0){        // Verificacin de canal AN0
-            LECTURA_POT = ADRESH;       // Almacenar el resgitro ADRESH en variable LECTURA_POT
+#if SERVO_RESOLUCION == 8
+            MUESTRA = ADRESH;           // Almacenar el resgitro ADRESH, se filtra en el ciclo principal
+            MUESTRA_NUEVA = 1;
+#elif SERVO_RESOLUCION == 10
+            MUESTRA = ((servo_t)ADRESH << 8) | ADRESL;  // Resultado de 10 bits justificado a la derecha
+            MUESTRA_NUEVA = 1;
+#else
+            SOBREMUESTREO_SUMA += ((uint16_t)ADRESH << 8) | ADRESL;
+            if(++SOBREMUESTREO_CUENTA < SERVO_SOBREMUESTREO){
+                ADCON0bits.GO = 1;      // Siguiente conversin (canal fijo, sin espera de adquisicin)
+            }
+            else{
+                MUESTRA = SOBREMUESTREO_SUMA >> 2;  // 16 muestras de 10 bits -> 12 bits
+                MUESTRA_NUEVA = 1;
+                SOBREMUESTREO_SUMA = 0;
+                SOBREMUESTREO_CUENTA = 0;
+            }
+#endif
         }
         PIR1bits.ADIF = 0;              // Limpieza de bandera de interrupcin
     } 
@@ -67,28 +162,60 @@ void __interrupt() isr (void){
 void main(void) {
     setup();
     while(1){
+        CLRWDT();                   // Servicio del watchdog una vez por ciclo
         // Activacin del proceso de conversin del mdulo ADC
         if(ADCON0bits.GO == 0){     // Si no hay proceso de conversin
             __delay_us(40);
             ADCON0bits.GO = 1;      // Ejecucin de proceso de conversin
         }
         
-        // Envo de valor al esclavo
-        PORTAbits.RA7 = 1;           // Deshabilitamos el ss del esclavo 2
-        SSPBUF = LECTURA_POT;        // Cargamos valor del potencimetro al buffer
-        while(!SSPSTATbits.BF){}     // Esperamos a que termine el envio
-        PORTAbits.RA7 = 0;           // habilitamos nuevamente el escalvo 2
+        // Filtrado de la lectura y umbral de cambio
+        if(MUESTRA_NUEVA && !FILTRO_LISTO){
+            // Primera muestra tras el reinicio: el filtro arranca en la posicin
+            // actual en lugar de subir desde 0 (el servo no recorre desde un extremo)
+            LECTURA_POT = sembrar_filtro(leer_muestra());
+            FILTRO_LISTO = 1;
+            ENVIO_PENDIENTE = 1;
+        }
+        else if(MUESTRA_NUEVA){
+            LECTURA_POT = filtro_iir(mediana(leer_muestra()));
+            DIFERENCIA = (LECTURA_POT > ULTIMO_ENVIADO) ? 
+                    LECTURA_POT - ULTIMO_ENVIADO : ULTIMO_ENVIADO - LECTURA_POT;
+            if(DIFERENCIA >= FILTRO_UMBRAL){
+                ENVIO_PENDIENTE = 1;    // El valor filtrado se movi lo suficiente
+            }
+            else{
+                TX_OMITIDOS++;          // Envo evitado por el umbral
+            }
+        }
+        if(FILTRO_LISTO && ++ENVIO_CUENTA >= ENVIO_PERIODO){
+            ENVIO_PENDIENTE = 1;        // Reenvo peridico aunque no haya cambio
+        }
         
-        // Cambio en el selector (SS) para generar respuesta del pic
-        PORTAbits.RA6 = 1;           // Deshabilitamos el ss del esclavo 1
-        PORTAbits.RA7 = 1;           // Deshabilitamos el ss del esclavo 2
-        __delay_ms(10);              // Delay para que el PIC pueda detectar el cambio en el pin
-        PORTAbits.RA7 = 0;           // habilitamos nuevamente el escalvo 2
-       
-        SSPBUF = FLAG_SPI;           // Master inicia la comunicacin y prende el clock
-        while(!SSPSTATbits.BF){}     // Esperamos a que se reciba un dato
-        PORTD = SSPBUF;              // Mostramos dato recibido en PORTD
-        PORTAbits.RA6 = 0;           // Deshabilitamos el ss del esclavo 1
+        // Envo de valor al esclavo (cambio significativo o reenvo peridico)
+        if(ENVIO_PENDIENTE && spi_disponible(&ESCLAVO_1)){
+            PORTAbits.RA6 = 0;           // Seleccionamos solo al esclavo 1
+            if(enviar_posicion(LECTURA_POT) == SPI_OK){
+#if LAZO_CERRADO
+                PORTB = POSICION_SERVO;  // Mostramos la posicin real en PORTB
+#endif
+                ULTIMO_ENVIADO = LECTURA_POT;
+                ENVIO_PENDIENTE = 0;     // Si falla se reintenta en el siguiente ciclo
+                ENVIO_CUENTA = 0;
+                TX_ENVIADOS++;
+            }
+            PORTAbits.RA6 = 1;           // Deshabilitamos el ss del esclavo 1
+        }
+        
+        // Lectura del contador del esclavo 2 (se omite si est cado)
+        if(spi_disponible(&ESCLAVO_2)){
+            _delay(SPI_GUARDA_SS_CICLOS); // SS en alto desde la lectura anterior: el esclavo recarga SSPBUF
+            PORTAbits.RA7 = 0;           // Seleccionamos solo al esclavo 2
+            if(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK){
+                PORTD = RESPUESTA;       // Mostramos el contador solo si la respuesta es vlida
+            }
+            PORTAbits.RA7 = 1;           // Deshabilitamos el ss del esclavo 2
+        }
     }
     return;
 }
@@ -97,47 +224,127 @@ void main(void) {
  * CONFIGURACION 
  ------------------------------------------------------------------------------*/
 void setup(void){       
-    // Configuracin del oscilador interno
-    OSCCONbits.IRCF = 0b100;    // 1MHz
-    OSCCONbits.SCS = 1;         // Reloj interno
+    // Banco 0: limpieza de puertos antes de habilitar salidas
+    PORTA = 0b11000000;                 // SS1 (RA6) y SS2 (RA7) en alto: ningn esclavo seleccionado
+    PORTB = 0x00;                       // Limpieza del PORTB
+    PORTC = 0x00;                       // Limpieza del PORTC
+    PORTD = 0x00;                       // Limpieza del PORTD
     
-    // Configuracin de puertos
-    ANSEL = 0b001;              // AN0 como entrada analgicas
-    ANSELH = 0x00;              // I/O digitales
-        
-    TRISA = 0b00000001;         // AN0 como entrada
-                                // RA6 (salida) se conectar al SS1 (RA5) del esclavo 1 (MCU2)
-                                // RA7 (salida) se conectar al SS2 (RA5) del esclavo 2 (MCU3)
-    TRISC = 0b00010000;         // SDI entrada, SCK y SD0 como salida
-    PORTCbits.RC4 = 0;
-    TRISD = 0x00;               // PORTD como salida
-    PORTA = 0x00;               // Limpieza del PORTA
-    PORTC = 0x00;               // Limpieza del PORTC
-    PORTD = 0x00;               // Limpieza del PORTD
+    // Banco 2: periodo del watchdog
+    WDTCON = CFG_WDTCON_VALOR;          // WDT 1:4096 (~132 ms)
     
-    // Configuracin de interrucpiones
-    PIR1bits.ADIF = 0;          // Limpiamos bandera de ADC
-    PIE1bits.ADIE = 1;          // Habilitamos interrupcion de ADC
-    INTCONbits.PEIE = 1;        // Habilitamos interrupciones de perifericos
-    INTCONbits.GIE = 1;         // Habilitamos interrupciones globales
+    // Banco 1: oscilador, puertos, SPI y ADC
+    OSCCON = CFG_OSCCON_VALOR;          // RELOJ_MHZ, reloj interno
+    TRISA = CFG_TRISA;
+    OPTION_REG = CFG_OPTION_REG_VALOR;  // Postscaler 1:1 asignado al WDT
+    TRISB = CFG_TRISB;
+    TRISC = CFG_TRISC;
+    TRISD = CFG_TRISD;
+    SSPSTAT = CFG_SSPSTAT_VALOR;        // CKE = 1, SMP = 1 (dato al final del pulso de reloj)
+    ADCON1 = CFG_ADCON1_VALOR;          // VDD/VSS, justificado segn SERVO_RESOLUCION
+    PIE1 = CFG_PIE1_VALOR;              // Habilitamos interrupcion de ADC
     
-    // Configuracin ADC
-    ADCON0bits.ADCS = 0b01;         // Fosc/8
-    ADCON1bits.VCFG0 = 0;           // VDD
-    ADCON1bits.VCFG1 = 0;           // VSS
-    ADCON0bits.CHS = 0b0000;        // Seleccin de canal AN0
-    ADCON1bits.ADFM = 0;            // Configuracin de justificado a la izquierda
-    ADCON0bits.ADON = 1;            // Habilitacin del modulo ADC
-    __delay_us(40);                 // Display de sample time
-        
-    // Configuracin de SPI    
-    // Configuracin del MAESTRO    
-    // SSPCON<5:0>
-    SSPCONbits.SSPM = 0b0000;   // SPI Maestro, Reloj -> Fosc/4 (250kbits/s)
-    SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-    SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI (Para que no los utilice como RPG)
-    // SSPSTAT<7:6>
-    SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-    SSPSTATbits.SMP = 1;        // Dato al final del pulso de reloj
-    SSPBUF = LECTURA_POT;       // Enviamos un dato inicial (valor inicial de la variable)
+    // Banco 3: entradas analgicas
+    ANSEL = CFG_ANSEL;
+    ANSELH = CFG_ANSELH;
+    
+    // Banco 0: habilitacin de perifricos
+    ADCON0 = CFG_ADCON0_VALOR;          // TAD segn el perfil, AN0, modulo ADC encendido
+    __delay_us(40);                     // Display de sample time
+    SSPCON = CFG_SSPCON_VALOR;          // SPI Maestro, reloj inactivo en 0
+    PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+    INTCON = CFG_INTCON_VALOR;          // GIE y PEIE al final
+}
+
+/*------------------------------------------------------------------------------
+ * FUNCIONES 
+ ------------------------------------------------------------------------------*/
+// Copia atmica de la lectura cruda (16 bits en alta resolucin)
+servo_t leer_muestra(void){
+    servo_t muestra;
+    INTCONbits.GIE = 0;
+    muestra = MUESTRA;
+    MUESTRA_NUEVA = 0;
+    INTCONbits.GIE = 1;
+    return muestra;
+}
+
+// Inicializacin del filtro con una muestra: ventana llena y IIR en reposo
+servo_t sembrar_filtro(servo_t muestra){
+    uint8_t i;
+    
+    for(i = 0; i < FILTRO_MEDIANA; i++){
+        VENTANA[i] = muestra;
+    }
+    VENTANA_INDICE = 0;
+    IIR_ACUM = (uint16_t)muestra << FILTRO_IIR_K;
+    return muestra;
+}
+
+// Filtro de mediana de FILTRO_MEDIANA muestras (elimina picos aislados)
+servo_t mediana(servo_t muestra){
+    servo_t orden[FILTRO_MEDIANA];  // Copia ordenada de la ventana
+    servo_t t;
+    uint8_t i, j;
+    
+    VENTANA[VENTANA_INDICE] = muestra;
+    if(++VENTANA_INDICE >= FILTRO_MEDIANA){
+        VENTANA_INDICE = 0;
+    }
+    
+    // Ordenamiento por insercin (a lo sumo 3 o 10 comparaciones)
+    for(i = 0; i < FILTRO_MEDIANA; i++){
+        t = VENTANA[i];
+        for(j = i; j > 0 && orden[j-1] > t; j--){
+            orden[j] = orden[j-1];
+        }
+        orden[j] = t;
+    }
+    return orden[FILTRO_MEDIANA/2];
+}
+
+// Filtro IIR de primer orden con coeficiente de solo corrimientos
+servo_t filtro_iir(servo_t muestra){
+    IIR_ACUM = IIR_ACUM - (IIR_ACUM >> FILTRO_IIR_K) + muestra;
+    return (servo_t)(IIR_ACUM >> FILTRO_IIR_K);
+}
+
+// Envo de un byte al esclavo 1
+//  Lazo cerrado: la respuesta es la posicin real (cualquier valor es vlido,
+//  solo se detecta la traba del SSP)
+//  Lazo abierto: el esclavo no carga SSPBUF y su SDO devuelve el eco del byte
+//  anterior (SSPSR); otra respuesta es una lnea flotante (esclavo ausente).
+//  Con el potencimetro en un extremo el eco (0x00 o 0xFF) no se distingue de
+//  la lnea flotante, y el primer byte tras un reinicio del master no se
+//  verifica (el esclavo guarda un byte anterior al reinicio).
+uint8_t enviar_byte(uint8_t dato){
+#if LAZO_CERRADO
+    return spi_transferir(&ESCLAVO_1, dato, &POSICION_SERVO);
+#else
+    uint8_t eco;
+    uint8_t valido;
+
+    if(spi_byte(&ESCLAVO_1, dato, &eco) != SPI_OK){
+        return SPI_TIMEOUT;
+    }
+    valido = !ECO_CONOCIDO || (eco == ULTIMO_BYTE_1);
+    ULTIMO_BYTE_1 = dato;
+    ECO_CONOCIDO = 1;
+    return spi_verificar(&ESCLAVO_1, valido);
+#endif
+}
+
+// Envo de la posicin al esclavo 1, en uno o dos bytes segn SERVO_RESOLUCION
+uint8_t enviar_posicion(servo_t valor){
+#if SERVO_BYTES == 1
+    return enviar_byte(valor);
+#else
+    uint8_t estado = enviar_byte(SERVO_BYTE_ALTO(valor));
+
+    if(estado != SPI_OK){
+        return estado;
+    }
+    _delay(SERVO_PAUSA_CICLOS);         // El esclavo debe leer SSPBUF antes del byte bajo
+    return enviar_byte(SERVO_BYTE_BAJO(valor));
+#endif
 }
@@ -4,7 +4,11 @@
  * 
  * MUC 2 - esclavo 1 del postlaboratorio 11 
  *  Recibe la seal de potencimetro proveniente del MCU3 - master
- *  Transforma la seal del POT a PWM para controlar un servomotor
+ *  Transforma la seal del POT en la seal de un servomotor (trama de 50 Hz
+ *  generada con CCP1 en modo comparacin sobre TMR1)
+ *  Resolucin de la posicin segn SERVO_RESOLUCION (servo-protocolo.h)
+ *  Lazo cerrado (opcional): control PI con potencimetro de retroalimentacin
+ *  en AN0/RA0 y respuesta de la posicin real al maestro
  * 
  * Created on 11 de mayo de 2022, 02:10 PM
  */
@@ -30,40 +34,180 @@
 
 #include <xc.h>
 #include <stdint.h>
+#include "servo-protocolo.h"
 
 /*------------------------------------------------------------------------------
  * CONSTANTES 
  ------------------------------------------------------------------------------*/
-#define _XTAL_FREQ 1000000      // Frecuencia de oscilador en 1 MHz
-#define IN_MIN 0                // Valor minimo de entrada del potenciometro
-#define IN_MAX 255              // Valor mximo de entrada del potenciometro
-#define OUT_MIN 62              // Valor minimo de ancho de pulso de seal PWM   (18 para servo MG996R)
-#define OUT_MAX 125             // Valor mximo de ancho de pulso de seal PWM   (79 para servo MG996R)
+#include "reloj.h"              // _XTAL_FREQ segn el perfil RELOJ_MHZ
+#define PULSO_MIN_US 1000       // Ancho de pulso mnimo del servo   (290 us para servo MG996R)
+#define PULSO_MAX_US 2000       // Ancho de pulso mximo del servo   (1260 us para servo MG996R)
+
+// Ancho de pulso en ciclos de TMR1 (4 us a 1 MHz, 0.5 us a 8 MHz)
+// Con signo: con int de 16 bits (XC8) un uint16_t hara sin signo la comparacin
+// con la salida del PI y una salida negativa se limitara a OUT_MAX
+#define OUT_MIN ((int16_t)US_A_CICLOS(PULSO_MIN_US))    // Valor minimo de ancho de pulso
+#define OUT_MAX ((int16_t)US_A_CICLOS(PULSO_MAX_US))    // Valor mximo de ancho de pulso
+
+// Producto de la interpolacin entera: 16 bits si cabe, si no 32 bits
+#if (SERVO_MAX * US_A_CICLOS(PULSO_MAX_US - PULSO_MIN_US)) > 0xFFFF
+typedef uint32_t producto_t;
+#else
+typedef uint16_t producto_t;
+#endif
+
+#ifndef MEDIR_LATENCIA
+#define MEDIR_LATENCIA 0        // 1 -> TMR1 mide la ISR contra SERVO_LATENCIA_ISR_CICLOS (igual que en lab-slave.c)
+#endif
+
+// Control en lazo cerrado (LAZO_CERRADO en servo-protocolo.h, compartido con el master)
+#define PI_DIVISOR 1            // Tramas del servo (20 ms) entre cada paso del control
+#define PI_KP 32                // Ganancia proporcional (KP/2^PI_SHIFT = 2 ciclos a 1 MHz, 8 us)
+#define PI_KI 4                 // Ganancia integral por paso (KI/2^PI_SHIFT = 0.25)
+                                // La correccin se multiplica por RELOJ_MHZ para conservar los us
+#define PI_SHIFT 4              // Escala de punto fijo de las ganancias (2^4 = 16)
+#define PI_INTEGRAL_MAX 1024    // Lmite del integrador (anti-windup)
+
+/*------------------------------------------------------------------------------
+ * DESCRIPCION DE PERIFERICOS
+ ------------------------------------------------------------------------------*/
+#define CFG_ROL ROL_ESCLAVO
+#define CFG_TRISD 0x00              // PORTD como salida
+#define CFG_SERVO_TRAMA_US 20000    // Trama de 20 ms (50 Hz) en cualquier perfil de reloj
+#define CFG_TRISC 0b00011100        // SDI, SCK y CCP1 (hasta iniciar la trama) entradas, SD0 responde al maestro
+                                    // (lazo cerrado: la posicin; lazo abierto: el eco del byte anterior)
+#if LAZO_CERRADO
+#define CFG_TRISA 0b00100001        // SS y AN0 como entradas
+#define CFG_ANSEL 0b00000001        // AN0 como entrada analgica (retroalimentacin)
+#define CFG_ADC_CANAL 0             // Seleccin de canal AN0
+#define CFG_INTERRUPCIONES (INT_SSP | INT_ADC | INT_CCP1)
+#else
+#define CFG_TRISA 0b00100000        // SS como entrada
+#define CFG_INTERRUPCIONES (INT_SSP | INT_CCP1)
+#endif
+#include "perifericos.h"
 
 /*------------------------------------------------------------------------------
  * VARIABLES 
  ------------------------------------------------------------------------------*/
-uint8_t CCPR;                   // Valor de la seal PWM
+uint16_t CCPR;                  // Ancho de pulso calculado (ciclos de TMR1)
+volatile uint16_t PULSO;        // Ancho de pulso que usa la ISR en la siguiente trama
+uint16_t PULSO_TRAMA;           // Ancho de pulso de la trama en curso (solo ISR)
+uint16_t FLANCO;                // Tiempo de TMR1 del siguiente flanco (solo ISR)
 uint8_t TEMPORAL;               // Variable para almacenar valores temporales
+volatile uint8_t SSPOV_CONTADOR; // Nmero de desbordes del SSPBUF (debe quedar en 0)
+volatile servo_t REFERENCIA;    // Posicin deseada proveniente del maestro
+volatile uint8_t REFERENCIA_NUEVA;  // Bandera de posicin recibida
+#if SERVO_BYTES == 2
+uint8_t BYTE_ALTO;              // Byte alto recibido, en espera del byte bajo
+uint8_t ALTO_VALIDO;            // Bandera de byte alto recibido
+#endif
+#if MEDIR_LATENCIA
+volatile uint8_t SSP_CICLOS_MAX;    // Ciclos desde la entrada a la ISR hasta leer SSPBUF
+volatile uint8_t ISR_CICLOS_MAX;    // Ciclos de la pasada ms larga por la ISR
+#endif
+
+#if LAZO_CERRADO
+volatile uint8_t POSICION;      // Posicin real (potencimetro de retroalimentacin)
+volatile uint8_t PI_PENDIENTE;  // Bandera de muestra nueva para el control
+volatile uint8_t PI_TICKS;      // Tramas del servo transcurridas
+volatile uint16_t TRAMA_INICIO; // Tiempo de TMR1 en que inici la trama en curso
+uint8_t PI_DIVISOR_CONTADOR;    // Contador de tramas para el paso de control
+int16_t PI_INTEGRAL;            // Acumulador del trmino integral
+uint8_t PI_TICK_INICIO;         // Trama en que inici el paso de control
+uint16_t PI_TIEMPO;             // Fin del paso de control (ciclos de TMR1 desde el inicio de la trama)
+uint16_t PI_TIEMPO_MAX;         // Mayor duracin medida (debe ser < CFG_SERVO_TRAMA_CICLOS)
+uint8_t PI_SOBRECARGA;          // Pasos que no terminaron dentro de una trama
+#endif
 
 /*------------------------------------------------------------------------------
  * PROTOTIPO DE FUNCIONES 
  ------------------------------------------------------------------------------*/
 void setup(void);
-unsigned short map(uint8_t val, uint8_t in_min, uint8_t in_max, 
-            unsigned short out_min, unsigned short out_max);
+servo_t leer_referencia(void);
+uint16_t mapear(servo_t ref);
+void fijar_pulso(uint16_t pulso);
+#if LAZO_CERRADO
+uint16_t control_pi(servo_t ref, uint8_t pos);
+uint16_t leer_tmr1(void);
+#endif
 
 /*------------------------------------------------------------------------------
  * INTERRUPCIONES 
  ------------------------------------------------------------------------------*/
 void __interrupt() isr (void){    
+#if MEDIR_LATENCIA
+    uint8_t inicio = TMR1L;             // TMR1 corre libre a Fosc/4 para la trama
+    uint8_t ciclos;
+#endif
     if (PIR1bits.SSPIF){                // Recibi datos el esclavo?
         TEMPORAL = SSPBUF;              // Se carga el valor proveniente del maestro a TEMPORAL para verificar que sea un dato
-        CCPR = map(TEMPORAL, IN_MIN, IN_MAX, OUT_MIN, OUT_MAX);   // Asignacin de valor de ancho de pulso a CCPR
-        CCPR1L = (uint8_t)(CCPR>>2);        // Almacenamiento de los 8 bits mas significativos en CCPR1L
-        CCP1CONbits.DC1B = CCPR & 0b11;     // Almacenamiento de los 2 bits menos significativos en DC1B
+#if LAZO_CERRADO
+        SSPBUF = POSICION;              // Respondemos al maestro con la posicin real
+#endif
+#if MEDIR_LATENCIA
+        ciclos = TMR1L - inicio;
+        if(ciclos > SSP_CICLOS_MAX){
+            SSP_CICLOS_MAX = ciclos;
+        }
+#endif
+        if(SSPCONbits.SSPOV){           // Lleg un dato antes de leer el anterior?
+            SSPOV_CONTADOR++;           // Registramos el desborde (el reenvo peridico del master
+            SSPCONbits.SSPOV = 0;       // repite la posicin perdida)
+        }
+#if SERVO_BYTES == 1
+        REFERENCIA = TEMPORAL;          // Nueva posicin, el mapeo se hace en el ciclo principal
+        REFERENCIA_NUEVA = 1;
+#else
+        if(TEMPORAL & SERVO_MARCA_ALTO){    // Byte alto: se espera el byte bajo
+            BYTE_ALTO = TEMPORAL & 0x7F;
+            ALTO_VALIDO = 1;
+        }
+        else if(ALTO_VALIDO){               // Byte bajo: posicin completa
+            REFERENCIA = ((servo_t)BYTE_ALTO << 7) | TEMPORAL;
+            REFERENCIA_NUEVA = 1;
+            ALTO_VALIDO = 0;
+        }
+#endif
         PIR1bits.SSPIF = 0;             // Limpiamos bandera de interrupcin
     }
+    if(PIR1bits.CCP1IF){                // Flanco programado de la seal del servo
+        if(CCP1CON == CCP1M_COMPARA_ALTO){  // Subida: inicia el pulso de esta trama
+            PULSO_TRAMA = PULSO;
+            FLANCO += PULSO_TRAMA;
+            CCP1CON = CCP1M_COMPARA_BAJO;
+        }
+        else{                           // Bajada: la siguiente subida cierra la trama
+            FLANCO += (uint16_t)CFG_SERVO_TRAMA_CICLOS - PULSO_TRAMA;
+            CCP1CON = CCP1M_COMPARA_ALTO;
+        }
+        CCPR1H = (uint8_t)(FLANCO >> 8);    // Byte alto primero: el valor intermedio nunca coincide con TMR1
+        CCPR1L = (uint8_t)FLANCO;
+#if LAZO_CERRADO
+        if(CCP1CON == CCP1M_COMPARA_BAJO){  // Inicio de trama
+            TRAMA_INICIO = FLANCO - PULSO_TRAMA;
+            PI_TICKS++;
+            if(++PI_DIVISOR_CONTADOR >= PI_DIVISOR){
+                PI_DIVISOR_CONTADOR = 0;
+                ADCON0bits.GO = 1;      // Muestreo de la posicin real (canal fijo, sin espera de adquisicin)
+            }
+        }
+#endif
+        PIR1bits.CCP1IF = 0;            // Limpieza de bandera de interrupcin del CCP1
+    }
+#if LAZO_CERRADO
+    if(PIR1bits.ADIF){                  // Verificacin de interrupcin del mdulo ADC
+        POSICION = ADRESH;              // Posicin real del servo
+        PI_PENDIENTE = 1;               // El paso de control se ejecuta en el ciclo principal
+        PIR1bits.ADIF = 0;              // Limpieza de bandera de interrupcin
+    }
+#endif
+#if MEDIR_LATENCIA
+    ciclos = TMR1L - inicio;
+    if(ciclos > ISR_CICLOS_MAX){
+        ISR_CICLOS_MAX = ciclos;
+    }
+#endif
     return;
 }
 
@@ -73,7 +217,28 @@ void __interrupt() isr (void){
 void main(void) {
     setup();
     while(1){        
-        // Envio y recepcion de datos en maestro
+#if LAZO_CERRADO
+        if(PI_PENDIENTE){               // Hay una muestra nueva de la posicin?
+            PI_PENDIENTE = 0;
+            PI_TICK_INICIO = PI_TICKS;
+            CCPR = control_pi(leer_referencia(), POSICION);
+            fijar_pulso(CCPR);
+            
+            // Medicin del tiempo del paso: debe terminar antes de la siguiente trama
+            PI_TIEMPO = leer_tmr1() - TRAMA_INICIO;
+            if(PI_TICKS != PI_TICK_INICIO){
+                PI_SOBRECARGA++;
+            }
+            else if(PI_TIEMPO > PI_TIEMPO_MAX){
+                PI_TIEMPO_MAX = PI_TIEMPO;
+            }
+        }
+#else
+        if(REFERENCIA_NUEVA){           // Lleg una posicin nueva del maestro?
+            CCPR = mapear(leer_referencia());
+            fijar_pulso(CCPR);
+        }
+#endif
     }
     return;
 }
@@ -82,70 +247,108 @@ void main(void) {
  * CONFIGURACION 
  ------------------------------------------------------------------------------*/
 void setup(void){   
-    TRISC = 0b00111000;         // SDI y SCK entradas, SD0 como salida
-    PORTCbits.RC5 = 0;
-    
-    // Configuracin del oscilador interno    
-    OSCCONbits.IRCF = 0b100;    // 1MHz
-    OSCCONbits.SCS = 1;         // Reloj interno
+    // Banco 0: limpieza de puertos antes de habilitar salidas
+    PORTA = 0x00;                       // Limpieza del PORTA
+    PORTC = 0x00;                       // Limpieza del PORTC
+    PORTD = 0x00;                       // Limpieza del PORTD
     
-    // Configuracin de puertos
-    ANSEL = 0x00;
-    ANSELH = 0x00;              // I/O digitales
-        
-    TRISA = 0b00100000;         // SS como entrada
-    TRISD = 0x00;               // PORTD como salida
+    // Banco 1: oscilador, puertos y SPI
+    OSCCON = CFG_OSCCON_VALOR;          // RELOJ_MHZ, reloj interno
+    TRISA = CFG_TRISA;
+    TRISC = CFG_TRISC;                  // Salida de CCP1 deshabilitada
+    TRISD = CFG_TRISD;
+    SSPSTAT = CFG_SSPSTAT_VALOR;        // CKE = 1, SMP = 0 (Siempre debe estar apagado para esclavos)
+#if LAZO_CERRADO
+    ADCON1 = CFG_ADCON1_VALOR;          // VDD/VSS, justificado a la izquierda (retroalimentacin de 8 bits)
+#endif
+    PIE1 = CFG_PIE1_VALOR;
     
-    PORTA = 0x00;               // Limpieza del PORTA
-    PORTC = 0x00;               // Limpieza del PORTC
-    PORTD = 0x00;               // Limpieza del PORTD
+    // Banco 3: entradas analgicas
+    ANSEL = CFG_ANSEL;
+    ANSELH = CFG_ANSELH;
     
-    // Configuracin de interrucpiones
-    INTCONbits.GIE = 1;         // Habilitamos interrupciones globales
-    INTCONbits.PEIE = 1;        // Habilitamos interrupciones de perifericos
-    PIR1bits.SSPIF = 0;         // Limpieza de bandera de SPI (Se debe limpiar manualmente por medio de software)
-    PIE1bits.SSPIE = 1;         // Habilitar interrupciones de SPI
+    // Banco 0: habilitacin de perifricos
+#if LAZO_CERRADO
+    ADCON0 = CFG_ADCON0_VALOR;          // TAD segn el perfil, AN0, modulo ADC encendido
+    __delay_us(40);                     // Display de sample time
+#endif
+    PULSO = (uint16_t)OUT_MIN;          // Ancho de pulso inicial
+    FLANCO = (uint16_t)CFG_SERVO_TRAMA_CICLOS;  // Primer pulso al terminar la primera trama
+    TMR1H = 0x00;
+    TMR1L = 0x00;
+    CCPR1H = (uint8_t)(FLANCO >> 8);
+    CCPR1L = (uint8_t)FLANCO;
+    CCP1CON = CCP1M_COMPARA_ALTO;       // CCP1 en bajo hasta el primer flanco de subida
+    SSPCON = CFG_SSPCON_VALOR;          // SPI Esclavo, SS hablitado, reloj inactivo en 0
+    PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+    T1CON = CFG_T1CON_VALOR;            // Encendemos TMR1 a Fosc/4, prescaler 1:1
     
-    // Configuracin de SPI
-    // Configuracin del ESCLAVO
-    // SSPCON <5:0>
-    SSPCONbits.SSPM = 0b0100;   // SPI Esclavo, SS hablitado
-    SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-    SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI
-    // SSPSTAT<7:6>
-    SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-    SSPSTATbits.SMP = 0;        // Dato al final del pulso de reloj (Siempre debe estar apagado para esclavos)
-    
-    // Configuracin PWM
-    PIR1bits.TMR2IF = 0;        // Limpiamos bandera de interrupcion del TMR2
-    T2CONbits.T2CKPS = 0b11;    // prescaler 1:16
-    T2CONbits.TMR2ON = 1;       // Encendemos TMR2
-    while(!PIR1bits.TMR2IF);    // Esperar un cliclo del TMR2
-    PIR1bits.TMR2IF = 0;        // Limpiamos bandera de interrupcion del TMR2 nuevamente
-    
-    TRISCbits.TRISC2 = 1;       // Deshabilitamos salida de CCP1
-    PR2 = 61;                   // periodo de 4 ms
-        
-    // PR2 = (PWM period)/(4(1/Fosc)(PrescalerTMR2))-1
-    // PR2 = (20 ms)/(4(1/1MHz)(16))-1
-    // PR2 = 61.5 = 61
-    
-    // Configuracin CCP
-    // CCP1
-    CCP1CON = 0;                // Apagamos CCP1
-    CCP1CONbits.P1M = 0;        // Modo single output
-    CCP1CONbits.CCP1M = 0b1100; // PWM       
-    CCPR1L = 250>>2;
-    CCP1CONbits.DC1B = 250 & 0b11;    
-   
-    TRISCbits.TRISC2 = 0;       // Habilitamos salida de PWM (CCP1)
+    TRISCbits.TRISC2 = 0;               // Habilitamos salida de CCP1
+    INTCON = CFG_INTCON_VALOR;          // GIE y PEIE al final
 }
 
 /*------------------------------------------------------------------------------
  * FUNCIONES 
  ------------------------------------------------------------------------------*/
-// Funcin para hacer la interpolacin lineal del valor de la entrada analgica 
-unsigned short map(uint8_t x, uint8_t x0, uint8_t x1, 
-            unsigned short y0, unsigned short y1){
-    return (unsigned short)(y0+((float)(y1-y0)/(x1-x0))*(x-x0));
-}
\ No newline at end of file
+// Copia atmica de la posicin recibida (16 bits en alta resolucin)
+servo_t leer_referencia(void){
+    servo_t ref;
+    INTCONbits.GIE = 0;
+    ref = REFERENCIA;
+    REFERENCIA_NUEVA = 0;
+    INTCONbits.GIE = 1;
+    return ref;
+}
+
+// Interpolacin lineal entera de la posicin (0-SERVO_MAX -> OUT_MIN-OUT_MAX)
+uint16_t mapear(servo_t ref){
+    return (uint16_t)(OUT_MIN + (((producto_t)ref*(OUT_MAX-OUT_MIN)) >> SERVO_RESOLUCION));
+}
+
+// Entrega el ancho de pulso a la ISR para la siguiente trama (escritura atmica)
+void fijar_pulso(uint16_t pulso){
+    INTCONbits.GIE = 0;
+    PULSO = pulso;
+    INTCONbits.GIE = 1;
+}
+
+#if LAZO_CERRADO
+// Paso del control PI en punto fijo, regresa el ancho de pulso (ciclos de TMR1)
+uint16_t control_pi(servo_t ref, uint8_t pos){
+    int16_t error = (int16_t)(ref >> (SERVO_RESOLUCION - 8)) - (int16_t)pos;  // Error en escala de 8 bits
+    int16_t salida;
+    
+    // Integrador con saturacin (anti-windup)
+    PI_INTEGRAL += error;
+    if(PI_INTEGRAL > PI_INTEGRAL_MAX){
+        PI_INTEGRAL = PI_INTEGRAL_MAX;
+    }
+    else if(PI_INTEGRAL < -PI_INTEGRAL_MAX){
+        PI_INTEGRAL = -PI_INTEGRAL_MAX;
+    }
+    
+    // Prealimentacin: interpolacin lineal entera de la referencia
+    salida = (int16_t)mapear(ref);
+    // Correccin PI: (KP*e + KI*integral)/2^PI_SHIFT, en ciclos de TMR1 del perfil
+    salida += (int16_t)(RELOJ_MHZ * ((PI_KP*error + PI_KI*PI_INTEGRAL)>>PI_SHIFT));
+    
+    // Limitamos al rango vlido del servo
+    if(salida > OUT_MAX){
+        salida = OUT_MAX;
+    }
+    else if(salida < OUT_MIN){
+        salida = OUT_MIN;
+    }
+    return (uint16_t)salida;
+}
+
+// Lectura de TMR1 sin error de acarreo entre TMR1L y TMR1H
+uint16_t leer_tmr1(void){
+    uint8_t alto, bajo;
+    do{
+        alto = TMR1H;
+        bajo = TMR1L;
+    }while(alto != TMR1H);
+    return ((uint16_t)alto << 8) | bajo;
+}
+#endif
\ No newline at end of file
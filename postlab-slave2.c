@@ -30,17 +30,44 @@
 
 #include <xc.h>
 #include <stdint.h>
+#include "cola-eventos.h"
 
 /*------------------------------------------------------------------------------
  * CONSTANTES 
  ------------------------------------------------------------------------------*/
-#define _XTAL_FREQ 1000000      // Frecuencia de oscilador en 1 MHz
-#define FLAG_SPI 0xFF           // Variable bandera para lectura del esclavo
+#include "reloj.h"              // _XTAL_FREQ segn el perfil RELOJ_MHZ
+#define FLAG_SPI 0xFF           // Variable bandera para lectura del esclavo (SPI_LEER del maestro)
+#ifndef MEDIR_LATENCIA
+#define MEDIR_LATENCIA 0        // 1 -> TMR1 mide la ISR (igual que en lab-slave.c)
+#endif
+
+/*------------------------------------------------------------------------------
+ * DESCRIPCION DE PERIFERICOS
+ ------------------------------------------------------------------------------*/
+#define CFG_ROL ROL_ESCLAVO
+#define CFG_TRISA 0b00100000        // SS como entrada
+#define CFG_TRISB 0b00000011        // RB0 y RB1 como entradas
+#define CFG_TRISC 0b00011000        // SDI y SCK entradas, SD0 como salida
+#define CFG_TRISD 0x00              // PORTD como salida
+#define CFG_PULLUPS_B 0b00000011    // Pull-ups en RB0 y RB1
+#define CFG_IOC_B 0b00000011        // Interrupcin por cambio de estado en RB0 y RB1
+#define CFG_INTERRUPCIONES (INT_SSP | INT_RB)
+#include "perifericos.h"
 
 /*------------------------------------------------------------------------------
  * VARIABLES 
  ------------------------------------------------------------------------------*/
-uint8_t CONTADOR;               // Valor del contador (Esclavo)
+volatile uint8_t CONTADOR;      // Valor del contador (Esclavo)
+volatile uint8_t SSPOV_CONTADOR; // Nmero de desbordes del SSPBUF (debe quedar en 0)
+cola_t EVENTOS;                 // Eventos de PORTB diferidos al ciclo principal
+uint8_t EVENTO;                 // Evento que se est procesando en main
+uint8_t EVENTO_ISR;             // Lectura de PORTB tomada en la ISR
+uint8_t TEMPORAL;               // Variable para almacenar valores temporales
+uint8_t ENVIADO;                // Contador entregado en la ltima lectura
+#if MEDIR_LATENCIA
+volatile uint8_t SSP_CICLOS_MAX;    // Ciclos desde la entrada a la ISR hasta recargar SSPBUF
+volatile uint8_t ISR_CICLOS_MAX;    // Ciclos de la pasada ms larga por la ISR
+#endif
 
 /*------------------------------------------------------------------------------
  * PROTOTIPO DE FUNCIONES 
@@ -51,20 +78,44 @@ void setup(void);
  * INTERRUPCIONES 
  ------------------------------------------------------------------------------*/
 void __interrupt() isr (void){
-    if(INTCONbits.RBIF){                // Verificacin de interrupcin del PORTB
-        if(!PORTBbits.RB0){             // Verificacin de interrupcin de RB0 (Incrementar)
-            CONTADOR++;                 // Incrementamos el contador del esclavo
+#if MEDIR_LATENCIA
+    uint8_t inicio = TMR1L;             // TMR1 libre a Fosc/4 (solo medicin)
+    uint8_t ciclos;
+#endif
+    // Mitad superior: solo lo crtico en tiempo, el SPI se atiende primero
+    if (PIR1bits.SSPIF){                // Interrupcin del SPI
+        TEMPORAL = SSPBUF;              // Lectura del dato del maestro (limpia BF, evita SSPOV)
+        if(TEMPORAL == FLAG_SPI){       // Lectura: el siguiente byte confirma con el complemento
+            SSPBUF = (uint8_t)~ENVIADO;
         }
-        else if(!PORTBbits.RB1){        // Verificacin de interrupcin de RB1 (Decrementar)
-            CONTADOR--;                 // Decrementamos el contador del esclavo
+        else{
+            ENVIADO = CONTADOR;         // Cargamos el valor del contador al maestro
+            SSPBUF = ENVIADO;
         }
-        INTCONbits.RBIF = 0;            // Limpieza de bandera de interrupcin del PORTB
+#if MEDIR_LATENCIA
+        ciclos = TMR1L - inicio;
+        if(ciclos > SSP_CICLOS_MAX){
+            SSP_CICLOS_MAX = ciclos;
+        }
+#endif
+        if(SSPCONbits.SSPOV){           // Lleg un dato antes de leer el anterior?
+            SSPOV_CONTADOR++;           // Registramos el desborde
+            SSPCONbits.SSPOV = 0;       // Limpiamos bandera de desborde
+        }
+        PIR1bits.SSPIF = 0;             // Limpiamos bandera de interrupcin
     }
     
-    if (PIR1bits.SSPIF){                // Interrupcin del SPI
-        SSPBUF = CONTADOR;              // Cargamos el valor del contador al maestro 
-        PIR1bits.SSPIF = 0;             // Limpiamos bandera de interrupcin
+    if(INTCONbits.RBIF){                // Verificacin de interrupcin del PORTB
+        EVENTO_ISR = PORTB;             // Lectura de PORTB (termina la condicin de cambio)
+        INTCONbits.RBIF = 0;            // Limpieza de bandera de interrupcin del PORTB
+        COLA_ENCOLAR(EVENTOS, EVENTO_ISR);  // Se difiere el conteo al ciclo principal
     }
+#if MEDIR_LATENCIA
+    ciclos = TMR1L - inicio;
+    if(ciclos > ISR_CICLOS_MAX){
+        ISR_CICLOS_MAX = ciclos;
+    }
+#endif
     return;
 }
 
@@ -74,7 +125,16 @@ void __interrupt() isr (void){
 void main(void) {
     setup();
     while(1){        
-        // Envio y recepcion de datos en maestro
+        // Mitad inferior: trabajo diferido por la ISR
+        while(!COLA_VACIA(EVENTOS)){
+            COLA_SACAR(EVENTOS, EVENTO);
+            if(!(EVENTO & 0b01)){       // Verificacin de RB0 (Incrementar)
+                CONTADOR++;             // Incrementamos el contador del esclavo
+            }
+            else if(!(EVENTO & 0b10)){  // Verificacin de RB1 (Decrementar)
+                CONTADOR--;             // Decrementamos el contador del esclavo
+            }
+        }
     }
     return;
 }
@@ -83,51 +143,33 @@ void main(void) {
  * CONFIGURACION 
  ------------------------------------------------------------------------------*/
 void setup(void){   
-    TRISC = 0b00011000;         // SDI y SCK entradas, SD0 como salida
-    PORTCbits.RC5 = 0;
+    // Banco 0: limpieza de puertos antes de habilitar salidas
+    PORTA = 0x00;                       // Limpieza del PORTA
+    PORTB = 0x00;                       // Limpieza del PORTB
+    PORTC = 0x00;                       // Limpieza del PORTC
+    PORTD = 0x00;                       // Limpieza del PORTD
     
-    // Configuracin del oscilador interno    
-    OSCCONbits.IRCF = 0b100;    // 1MHz
-    OSCCONbits.SCS = 1;         // Reloj interno
+    // Banco 1: oscilador, puertos y SPI
+    OSCCON = CFG_OSCCON_VALOR;          // RELOJ_MHZ, reloj interno
+    TRISA = CFG_TRISA;
+    TRISB = CFG_TRISB;
+    TRISC = CFG_TRISC;
+    TRISD = CFG_TRISD;
+    OPTION_REG = CFG_OPTION_REG_VALOR;  // Habilitacin de resistencias de pull-up del PORTB
+    WPUB = CFG_WPUB_VALOR;
+    IOCB = CFG_IOCB_VALOR;
+    SSPSTAT = CFG_SSPSTAT_VALOR;        // CKE = 1, SMP = 0 (Siempre debe estar apagado para esclavos)
+    PIE1 = CFG_PIE1_VALOR;              // Habilitar interrupciones de SPI
     
-    // Configuracin de puertos
-    ANSEL = 0x00;
-    ANSELH = 0x00;              // I/O digitales
-        
-    TRISA = 0b00100000;         // SS como entrada
-    TRISB = 0b00000011;         // RB0 y RB1 como entradas
-    TRISD = 0x00;               // PORTD como salida
+    // Banco 3: I/O digitales
+    ANSEL = CFG_ANSEL;
+    ANSELH = CFG_ANSELH;
     
-    PORTA = 0x00;               // Limpieza del PORTA
-    PORTB = 0x00;               // Limpieza del PORTB
-    PORTC = 0x00;               // Limpieza del PORTC
-    PORTD = 0x00;               // Limpieza del PORTD
-    
-    // Configuracin de interrucpiones
-    INTCONbits.GIE = 1;         // Habilitamos interrupciones globales
-    //INTCONbits.PEIE = 1;      // Habilitamos interrupciones de perifericos
-    INTCONbits.RBIE = 1;        // Habilitacin de interrupciones del PORTB
-    INTCONbits.RBIF = 0;        // Limpieza bandera de interrupcin del PORTB
-    
-    // Configuracin de interrupciones por cambio de estado para PORTB
-    IOCBbits.IOCB0 = 1;         // Habilitacin de interrupcin por cambio de estado para RB0
-    IOCBbits.IOCB1 = 1;         // Habilitacin de interrupcin por cambio de estado para RB1
-    OPTION_REGbits.nRBPU = 0;   // Habilitacin de resistencias de pull-up del PORTB
-    WPUBbits.WPUB0 = 1;         // Habilitacin de resistencia de pull-up de RB0
-    WPUBbits.WPUB1 = 1;         // Habilitacin de resistencia de pull-up de RB1
-    
-    // Configuracin de SPI
-    // Configuracin del ESCLAVO
-    // SSPCON <5:0>
-    SSPCONbits.SSPM = 0b0100;   // SPI Esclavo, SS hablitado
-    SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-    SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI
-    // SSPSTAT<7:6>
-    SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-    SSPSTATbits.SMP = 0;        // Dato al final del pulso de reloj (Siempre debe estar apagado para esclavos)
-
-    PIR1bits.SSPIF = 0;         // Limpieza de bandera de SPI (Se debe limpiar manualmente por medio de software)
-    PIE1bits.SSPIE = 1;         // Habilitar interrupciones de SPI
-    INTCONbits.GIE = 1;         // Habilitar interrupciones globales
-    INTCONbits.PEIE = 1;        // Habilitar interrupciones de perifricos
-}
\ No newline at end of file
+    // Banco 0: habilitacin de perifricos
+#if MEDIR_LATENCIA
+    T1CON = T1CON_TMR1ON;               // TMR1 libre para medir la ISR
+#endif
+    SSPCON = CFG_SSPCON_VALOR;          // SPI Esclavo, SS hablitado, reloj inactivo en 0
+    PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+    INTCON = CFG_INTCON_VALOR;          // GIE, PEIE y RBIE al final (limpia RBIF)
+}
@@ -7,7 +7,7 @@
 
 // CONFIG1
 #pragma config FOSC = INTRC_NOCLKOUT    // Oscillator Selection bits (INTOSCIO oscillator: I/O function on RA6/OSC2/CLKOUT pin, I/O function on RA7/OSC1/CLKIN)
-#pragma config WDTE = OFF               // Watchdog Timer Enable bit (WDT disabled and can be enabled by SWDTEN bit of the WDTCON register)
+#pragma config WDTE = ON                // Watchdog Timer Enable bit (WDT enabled)
 #pragma config PWRTE = OFF              // Power-up Timer Enable bit (PWRT disabled)
 #pragma config MCLRE = OFF              // RE3/MCLR pin function select bit (RE3/MCLR pin function is digital input, MCLR internally tied to VDD)
 #pragma config CP = OFF                 // Code Protection bit (Program memory code protection is disabled)
@@ -30,13 +30,33 @@
 /*------------------------------------------------------------------------------
  * CONSTANTES 
  ------------------------------------------------------------------------------*/
-#define _XTAL_FREQ 1000000      // Frecuencia de oscilador en 1 MHz
+#include "reloj.h"              // _XTAL_FREQ segn el perfil RELOJ_MHZ
+
+/*------------------------------------------------------------------------------
+ * DESCRIPCION DE PERIFERICOS
+ ------------------------------------------------------------------------------*/
+#define CFG_ROL ROL_CONMUTABLE      // RA7 decide el rol al arrancar
+#define CFG_TRISA 0b10100001        // SS, RA7 y AN0 como entradas
+#define CFG_TRISD 0x00              // PORTD como salida
+#define CFG_TRISC_MAESTRO 0b00010000    // SDI entrada, SCK y SD0 como salida
+#define CFG_TRISC_ESCLAVO 0b00011000    // SDI y SCK entradas, SD0 como salida
+#define CFG_ANSEL_MAESTRO 0b00000001    // AN0 como entrada analgica
+#define CFG_ANSEL_ESCLAVO 0x00          // I/O digitales
+#define CFG_INTERRUPCIONES_MAESTRO INT_ADC
+#define CFG_INTERRUPCIONES_ESCLAVO INT_SSP
+#define CFG_ADC_CANAL 0             // Seleccin de canal AN0
+#define CFG_WDTPS WDTPS_1_4096      // Watchdog de ~132 ms
+#include "perifericos.h"
+#include "spi-maestro.h"
 
 /*------------------------------------------------------------------------------
  * VARIABLES 
  ------------------------------------------------------------------------------*/
 int LECTURA_POT;               // Variable de contador que enva el maestro al esclavo
 
+spi_esclavo_t ESCLAVO = SPI_ESCLAVO(0x01, SPI_ESPERA_DEFECTO);  // Estado del esclavo (rol maestro)
+uint8_t RESPUESTA;              // Dato recibido del esclavo
+
 /*------------------------------------------------------------------------------
  * PROTOTIPO DE FUNCIONES 
  ------------------------------------------------------------------------------*/
@@ -65,12 +85,12 @@ void __interrupt() isr (void){
 void main(void) {
     setup();
     while(1){
+        CLRWDT();                   // Servicio del watchdog una vez por ciclo
         if(ADCON0bits.GO == 0){     // Si no hay proceso de conversin
             ADCON0bits.GO = 1;      // Ejecucin de proceso de conversin
         }
-        if(PORTAbits.RA7){          // Es maestro?
-            SSPBUF = LECTURA_POT;   // Cargamos valor del potencimetro al buffer
-            while(!SSPSTATbits.BF); // Esperamos a que termine el envio
+        if(PORTAbits.RA7 && spi_disponible(&ESCLAVO)){  // Es maestro? (el esclavo no responde datos: solo se vigila el SSP propio)
+            spi_transferir(&ESCLAVO, (uint8_t)LECTURA_POT, &RESPUESTA);   // Envo del valor del potencimetro
         }        
     }
     return;
@@ -80,71 +100,51 @@ void main(void) {
  * CONFIGURACION 
  ------------------------------------------------------------------------------*/
 void setup(void){       
-    OSCCONbits.IRCF = 0b100;    // 1MHz
-    OSCCONbits.SCS = 1;         // Reloj interno
+    // Banco 0: limpieza de puertos antes de habilitar salidas
+    PORTA = 0x00;                       // Limpieza del PORTA
+    PORTC = 0x00;                       // Limpieza del PORTC
+    PORTD = 0x00;                       // Limpieza del PORTD
     
-    ANSEL = 0b001;              // AN0 como entrada analgicas
-    ANSELH = 0x00;              // I/O digitales
-        
-    TRISA = 0b10100001;         // SS y RA7 como entradas
-    PORTA = 0x00;               // Limpieza del PORTA
- 
-    TRISD = 0x00;               // PORTD como salida
-    PORTD = 0x00;               // Limpieza del PORTD
+    // Banco 2: periodo del watchdog
+    WDTCON = CFG_WDTCON_VALOR;          // WDT 1:4096 (~132 ms)
+    
+    // Banco 1: oscilador y puertos comunes
+    OSCCON = CFG_OSCCON_VALOR;          // RELOJ_MHZ, reloj interno
+    TRISA = CFG_TRISA;
+    OPTION_REG = CFG_OPTION_REG_VALOR;  // Postscaler 1:1 asignado al WDT
+    TRISD = CFG_TRISD;
     
-    // Configuracin de SPI    
     // Configuracin del MAESTRO
     if(PORTAbits.RA7){
-        TRISC = 0b00010000;         // SDI entrada, SCK y SD0 como salida
-        PORTC = 0x00;               // Limpieza del PORTC
-        
-        // Configuracin de interrucpiones
-        PIR1bits.ADIF = 0;          // Limpiamos bandera de ADC
-        PIE1bits.ADIE = 1;          // Habilitamos interrupcion de ADC
-        INTCONbits.PEIE = 1;        // Habilitamos interrupciones de perifericos
-        INTCONbits.GIE = 1;         // Habilitamos interrupciones globales
-        
-        // Configuracin ADC
-        ADCON0bits.ADCS = 0b01;         // Fosc/8
-        ADCON1bits.VCFG0 = 0;           // VDD
-        ADCON1bits.VCFG1 = 0;           // VSS
-        ADCON0bits.CHS = 0b0000;        // Seleccin de canal AN0
-        ADCON1bits.ADFM = 0;            // Configuracin de justificado a la izquierda
-        ADCON0bits.ADON = 1;            // Habilitacin del modulo ADC
-        __delay_us(40);                 // Display de sample time
-    
-        // SSPCON<5:0>
-        SSPCONbits.SSPM = 0b0000;   // SPI Maestro, Reloj -> Fosc/4 (250kbits/s)
-        SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-        SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI (Para que no los utilice como RPG)
-        // SSPSTAT<7:6>
-        SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-        SSPSTATbits.SMP = 1;        // Dato al final del pulso de reloj
-        SSPBUF = LECTURA_POT;       // Enviamos un dato inicial (valor inicial de la variable)
+        // Banco 1
+        TRISC = CFG_TRISC_MAESTRO;
+        SSPSTAT = SSPSTAT_MAESTRO_VALOR;    // CKE = 1, SMP = 1
+        ADCON1 = CFG_ADCON1_VALOR;          // VDD/VSS, justificado a la izquierda
+        PIE1 = PIE1_DE(CFG_INTERRUPCIONES_MAESTRO);
+        // Banco 3
+        ANSEL = CFG_ANSEL_MAESTRO;
+        ANSELH = 0x00;
+        // Banco 0
+        ADCON0 = CFG_ADCON0_VALOR;          // TAD segn el perfil, AN0, modulo ADC encendido
+        __delay_us(40);                     // Display de sample time
+        SSPCON = SSPCON_MAESTRO_VALOR;      // SPI Maestro, reloj inactivo en 0
+        PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+        SSPBUF = LECTURA_POT;               // Enviamos un dato inicial (valor inicial de la variable)
+        INTCON = INTCON_DE(CFG_INTERRUPCIONES_MAESTRO);
     }
     
     // Configuracin del ESCLAVO
     else{
-        ANSEL = 0x00;
-        ANSELH = 0x00;              // I/O digitales
-    
-        TRISC = 0b00011000;         // SDI y SCK entradas, SD0 como salida
-        TRISD = 0x00;               // PORTD como salida digital
-        PORTC = 0x00;               // Limpieza del PORTC
-        PORTD = 0x00;               // Limpieza del PORTD
-        
-        // SSPCON <5:0>
-        SSPCONbits.SSPM = 0b0100;   // SPI Esclavo, SS hablitado
-        SSPCONbits.CKP = 0;         // Reloj inactivo en 0
-        SSPCONbits.SSPEN = 1;       // Habilitamos pines de SPI
-        // SSPSTAT<7:6>
-        SSPSTATbits.CKE = 1;        // Dato enviado cada flanco de subida
-        SSPSTATbits.SMP = 0;        // Dato al final del pulso de reloj (Siempre debe estar apagado para esclavos)
-        
-        PIR1bits.SSPIF = 0;         // Limpieza de bandera de SPI (Se debe limpiar manualmente por medio de software)
-        PIE1bits.SSPIE = 1;         // Habilitar interrupciones de SPI
-        INTCONbits.GIE = 1;         // Habilitar interrupciones globales
-        INTCONbits.PEIE = 1;        // Habilitar interrupciones de perifricos
+        // Banco 1
+        TRISC = CFG_TRISC_ESCLAVO;
+        SSPSTAT = SSPSTAT_ESCLAVO_VALOR;    // CKE = 1, SMP = 0 (Siempre debe estar apagado para esclavos)
+        PIE1 = PIE1_DE(CFG_INTERRUPCIONES_ESCLAVO);
+        // Banco 3
+        ANSEL = CFG_ANSEL_ESCLAVO;
+        ANSELH = 0x00;
+        // Banco 0
+        SSPCON = SSPCON_ESCLAVO_VALOR;      // SPI Esclavo, SS hablitado
+        PIR1 = 0x00;                        // Limpieza de banderas de perifricos
+        INTCON = INTCON_DE(CFG_INTERRUPCIONES_ESCLAVO);
     }
 }
-
@@ -0,0 +1,98 @@
+#
+# File:   presupuesto.awk
+# Author: Pablo Caal
+#
+# Reporte de uso de memoria de un programa compilado con XC8 (PIC16F887)
+#  Entrada: <programa>.lst <programa>.map (en ese orden)
+#  Variables: programa, codigo_max (palabras), ram_max (bytes)
+#  Imprime una tabla por funcion (codigo del .map, RAM del .lst), incluyendo
+#  las rutinas de libreria (p. ej. punto flotante), y termina con codigo 1
+#  si el programa excede alguno de los dos presupuestos.
+#  El total de codigo suma todas las clases en memoria de programa: CODE,
+#  tablas const (CONST, STRING, STRCODE) y ENTRY; la tabla por funcion solo
+#  muestra CODE.
+#
+# Created on 19 de octubre de 2026
+#
+
+function hex(s,    i, n, c) {
+    n = 0
+    s = toupper(s)
+    for (i = 1; i <= length(s); i++) {
+        c = index("0123456789ABCDEF", substr(s, i, 1))
+        if (c == 0) return -1
+        n = n * 16 + c - 1
+    }
+    return n
+}
+
+function base(ruta) {
+    gsub(/\\/, "/", ruta)
+    sub(/.*\//, "", ruta)
+    return ruta
+}
+
+{ sub(/\r$/, "") }
+
+# .lst: RAM usada por cada funcion
+FNR == NR {
+    if (match($0, /\*+ function [_A-Za-z0-9@]+ \*+/)) {
+        funcion = $0
+        sub(/.*\*+ function /, "", funcion)
+        sub(/ .*/, "", funcion)
+    }
+    else if (funcion != "" && match($0, /;;Total ram usage: *[0-9]+ bytes/)) {
+        ram = $0
+        sub(/.*ram usage: */, "", ram)
+        ram_funcion[funcion] = ram + 0
+        funcion = ""
+    }
+    next
+}
+
+# .map: totales por clase de memoria
+/^TOTAL/ { en_total = 1; next }
+/^SEGMENTS/ { en_total = 0 }
+en_total && $1 == "CLASS" { clase = $2; next }
+en_total && NF == 5 && hex($4) >= 0 {
+    if (clase ~ /^(CODE|CONST|STRCODE|STRING|ENTRY)$/) codigo_total += hex($4)
+    else if (clase ~ /^(COMMON|BANK[0-3]|ABS1)$/) ram_total += hex($4)
+    next
+}
+
+# .map: tamano de codigo de cada funcion
+/^MODULE INFORMATION/ { en_modulos = 1; next }
+en_modulos && /estimated size:/ { next }
+en_modulos && /^[^\t ]/ && NF > 0 {
+    modulo = base($0)
+    libreria = ($0 ~ /[\\\/]/) ? " (lib)" : ""
+    next
+}
+en_modulos && /^\t/ && NF >= 5 && $2 == "CODE" {
+    n++
+    nombre[n] = $1
+    origen[n] = modulo libreria
+    tamano[n] = $5 + 0
+}
+
+END {
+    printf "\n%s\n", programa
+    printf "  %-24s %-20s %8s %6s\n", "Funcion", "Modulo", "Palabras", "RAM"
+    for (i = 1; i <= n; i++) {
+        r = (nombre[i] in ram_funcion) ? ram_funcion[nombre[i]] : "-"
+        printf "  %-24s %-20s %8d %6s\n", nombre[i], origen[i], tamano[i], r
+    }
+    printf "  Codigo: %d de %d palabras\n", codigo_total, codigo_max
+    printf "  RAM:    %d de %d bytes\n", ram_total, ram_max
+
+    estado = 0
+    if (codigo_total > codigo_max) {
+        printf "  ERROR: %s excede el presupuesto de codigo\n", programa
+        estado = 1
+    }
+    if (ram_total > ram_max) {
+        printf "  ERROR: %s excede el presupuesto de RAM\n", programa
+        estado = 1
+    }
+    exit estado
+}
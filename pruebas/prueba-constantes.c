@@ -0,0 +1,116 @@
+/*
+ * File:   prueba-constantes.c
+ * Author: Pablo Caal
+ *
+ * Valores derivados del perfil de reloj (reloj.h, perifericos.h) y del
+ * control PI de postlab-slave1.c en lazo cerrado. Se compila una vez por
+ * perfil con -DRELOJ_MHZ=1, 4 u 8 y se compara contra la tabla esperada:
+ *
+ *  RELOJ_MHZ  IRCF   ADCS (TAD)      SSPM (SCK)          Trama    Pulso
+ *  1          0b100  Fosc/2  (2 us)  Fosc/16 (62.5 kHz)  5000     250-500
+ *  4          0b110  Fosc/8  (2 us)  Fosc/16 (250 kHz)   20000    1000-2000
+ *  8          0b111  Fosc/32 (4 us)  Fosc/16 (500 kHz)   40000    2000-4000
+ *
+ * SCK alto y bajo deben durar al menos Tcy + 20 ns en el esclavo (mismo
+ * reloj): Fosc/4 da medio Tcy en cualquier perfil, por eso siempre Fosc/16.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#define PROGRAMA "postlab-slave1.c"
+#include "prueba.h"
+
+#if !LAZO_CERRADO
+#error "Compile con -DLAZO_CERRADO=1 (se prueba control_pi)"
+#endif
+
+/*------------------------------------------------------------------------------
+ * VALORES ESPERADOS
+ ------------------------------------------------------------------------------*/
+#if RELOJ_MHZ == 1
+#define ESPERADO_IRCF 0b100
+#define ESPERADO_ADCS ADCS_FOSC_2
+#define ESPERADO_SSPM SSPM_MAESTRO_FOSC_16
+#define ESPERADO_TRAMA 5000
+#define ESPERADO_OUT_MIN 250
+#define ESPERADO_OUT_MAX 500
+#elif RELOJ_MHZ == 4
+#define ESPERADO_IRCF 0b110
+#define ESPERADO_ADCS ADCS_FOSC_8
+#define ESPERADO_SSPM SSPM_MAESTRO_FOSC_16
+#define ESPERADO_TRAMA 20000
+#define ESPERADO_OUT_MIN 1000
+#define ESPERADO_OUT_MAX 2000
+#else
+#define ESPERADO_IRCF 0b111
+#define ESPERADO_ADCS ADCS_FOSC_32
+#define ESPERADO_SSPM SSPM_MAESTRO_FOSC_16
+#define ESPERADO_TRAMA 40000
+#define ESPERADO_OUT_MIN 2000
+#define ESPERADO_OUT_MAX 4000
+#endif
+
+/*------------------------------------------------------------------------------
+ * PRUEBAS
+ ------------------------------------------------------------------------------*/
+// Posicin en escala de SERVO_RESOLUCION a partir de una de 8 bits
+#define REF_8(v) ((servo_t)((servo_t)(v) << (SERVO_RESOLUCION - 8)))
+
+static void registros(void){
+    VERIFICAR(CFG_IRCF == ESPERADO_IRCF);
+    VERIFICAR(CFG_OSCCON_VALOR == ((ESPERADO_IRCF << 4) | OSCCON_SCS));
+    VERIFICAR(CFG_ADC_ADCS == ESPERADO_ADCS);
+    VERIFICAR((CFG_ADCON0_VALOR >> 6) == ESPERADO_ADCS);
+    VERIFICAR(TOSC_A_NS(ADCS_DIVISOR_DE(CFG_ADC_ADCS)) >= TAD_MIN_NS);
+    VERIFICAR(CFG_SPI_DIV == ESPERADO_SSPM);
+    VERIFICAR((SSPCON_MAESTRO_VALOR & 0x0F) == ESPERADO_SSPM);
+    VERIFICAR(_XTAL_FREQ / SPI_DIVISOR <= SPI_FRECUENCIA_MAX);
+    VERIFICAR(TOSC_A_NS(SPI_DIVISOR / 2) >= TOSC_A_NS(4) + 20);     // Medio periodo de SCK >= Tcy + 20 ns
+}
+
+static void tiempos(void){
+    VERIFICAR(US_A_CICLOS(20000) == ESPERADO_TRAMA);
+    VERIFICAR(CFG_SERVO_TRAMA_CICLOS == ESPERADO_TRAMA);
+    VERIFICAR(OUT_MIN == ESPERADO_OUT_MIN);
+    VERIFICAR(OUT_MAX == ESPERADO_OUT_MAX);
+    VERIFICAR((__typeof__(OUT_MIN))-1 < 0);    // Con signo: ver el lmite en control_pi
+    VERIFICAR((__typeof__(OUT_MAX))-1 < 0);
+    VERIFICAR(mapear(0) == ESPERADO_OUT_MIN);
+    VERIFICAR(mapear(SERVO_MAX) <= ESPERADO_OUT_MAX);
+    VERIFICAR(SERVO_PAUSA_CICLOS > 0);
+}
+
+static void control(void){
+    int16_t correccion;
+
+    // Error de 10 en el primer paso: (32*10 + 4*10) >> 4 = 22 ciclos a 1 MHz,
+    // RELOJ_MHZ veces ms a 4 y 8 MHz; siempre 88 us
+    PI_INTEGRAL = 0;
+    correccion = (int16_t)control_pi(REF_8(128), 118) - (int16_t)mapear(REF_8(128));
+    VERIFICAR(correccion == 22 * RELOJ_MHZ);
+    VERIFICAR(correccion * 4 / RELOJ_MHZ == 88);
+
+    // Salida negativa (referencia 0, posicin 255): se limita al mnimo
+    PI_INTEGRAL = 0;
+    VERIFICAR(control_pi(0, 255) == ESPERADO_OUT_MIN);
+    PI_INTEGRAL = -PI_INTEGRAL_MAX;
+    VERIFICAR(control_pi(0, 255) == ESPERADO_OUT_MIN);
+
+    // Salida sobre el mximo: se limita al mximo
+    PI_INTEGRAL = PI_INTEGRAL_MAX;
+    VERIFICAR(control_pi(REF_8(255), 0) == ESPERADO_OUT_MAX);
+
+    // Sin error ni integral: solo la prealimentacin
+    PI_INTEGRAL = 0;
+    VERIFICAR(control_pi(REF_8(100), 100) == mapear(REF_8(100)));
+}
+
+int main(void){
+    printf("postlab-slave1.c (RELOJ_MHZ = %d, SERVO_RESOLUCION = %d, lazo cerrado)\n",
+           RELOJ_MHZ, SERVO_RESOLUCION);
+    registros();
+    tiempos();
+    control();
+
+    return PRUEBA_RESULTADO();
+}
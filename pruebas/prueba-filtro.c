@@ -0,0 +1,248 @@
+/*
+ * File:   prueba-filtro.c
+ * Author: Pablo Caal
+ *
+ * Filtro del potencimetro de postlab-master.c (mediana + IIR + umbral) con
+ * el ciclo principal real: el ADC simulado (prueba_adc) entrega una secuencia
+ * de muestras y el bus SPI simulado decodifica las posiciones que recibe el
+ * esclavo 1 (RA6 en bajo; responde con el eco del byte anterior). El esclavo
+ * 2 responde como postlab-slave2.c para que el ciclo tenga su duracin real.
+ *
+ * Las secuencias se escriben en unidades de 8 bits (0-255) y llegan al filtro
+ * en la escala de SERVO_RESOLUCION (ESCALA). Se verifica:
+ *  - Arranque: el primer envo es la primera muestra, sin rampa desde 0
+ *  - Ruido de +-1 con picos aislados: la mediana elimina los picos y la
+ *    salida no se aleja ms de 1 de la base
+ *  - Escaln: la salida sube sin sobrepaso y converge al valor final en a lo
+ *    sumo seis constantes de tiempo del IIR ms el retraso de la mediana
+ *  y se imprimen los envos contra las muestras y la latencia del escaln.
+ *  En el host el ciclo principal da ms vueltas por muestra que en el PIC
+ *  (sobre todo con 12 bits), as que los reenvos peridicos salen ms seguido.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#define PROGRAMA "postlab-master.c"
+#include "prueba.h"
+
+/*------------------------------------------------------------------------------
+ * HARDWARE SIMULADO
+ ------------------------------------------------------------------------------*/
+#define MUESTRAS_MAX 128
+#define ESCALA(x) ((servo_t)((servo_t)(x) << (SERVO_RESOLUCION - 8)))
+
+#if SERVO_RESOLUCION == 12
+#define CONVERSIONES_POR_MUESTRA SERVO_SOBREMUESTREO
+#else
+#define CONVERSIONES_POR_MUESTRA 1
+#endif
+
+static const uint8_t *ENTRADA;      // Secuencia del potencimetro (unidades de 8 bits)
+static unsigned N_MUESTRAS;         // Muestras de la secuencia
+static unsigned CONVERSIONES;       // Conversiones del ADC en la corrida
+static unsigned ENTREGADAS;         // Muestras completas entregadas a la ISR
+static servo_t SALIDA[MUESTRAS_MAX];    // LECTURA_POT tras filtrar cada muestra
+
+static servo_t RECIBIDAS[4 * MUESTRAS_MAX];     // Posiciones decodificadas por el esclavo 1
+static unsigned RECIBIDAS_MUESTRA[4 * MUESTRAS_MAX];    // Muestras entregadas al recibir cada una
+static unsigned N_RECIBIDAS;
+
+static uint8_t ESCRITO;             // SSPBUF escrito, el byte sale en el siguiente acceso
+static uint8_t ECO_1;               // SSPSR del esclavo 1 (ltimo byte recibido)
+#if SERVO_BYTES == 2
+static uint8_t ALTO_1;              // Byte alto pendiente en el esclavo 1
+#endif
+static uint8_t CARGA_2;             // SSPBUF cargado por la ISR del esclavo 2
+
+// Conversin del ADC: la primera de cada muestra registra la salida del
+// filtro para la muestra anterior (ya la consumi el ciclo principal)
+static uint16_t adc(void){
+    unsigned c = CONVERSIONES++;
+    unsigned k = c / CONVERSIONES_POR_MUESTRA;
+
+    if(c % CONVERSIONES_POR_MUESTRA == 0 && k > 0){
+        SALIDA[k-1] = LECTURA_POT;
+        if(k == N_MUESTRAS){
+            prueba_salir();             // Fin de la secuencia
+        }
+    }
+    if((c + 1) % CONVERSIONES_POR_MUESTRA == 0){
+        ENTREGADAS = k + 1;
+    }
+    return (uint16_t)ENTRADA[k] << 2;   // 10 bits: ADRESH = valor con 8 bits, suma de 16 >> 2 = valor << 4
+}
+
+static void recibir_1(uint8_t dato){
+    if(N_RECIBIDAS >= sizeof RECIBIDAS / sizeof RECIBIDAS[0]){
+        return;
+    }
+#if SERVO_BYTES == 1
+    RECIBIDAS[N_RECIBIDAS] = dato;
+#else
+    if(dato & SERVO_MARCA_ALTO){
+        ALTO_1 = dato;
+        return;
+    }
+    RECIBIDAS[N_RECIBIDAS] = (servo_t)(((servo_t)(ALTO_1 & 0x7F) << 7) | dato);
+#endif
+    RECIBIDAS_MUESTRA[N_RECIBIDAS++] = ENTREGADAS;
+}
+
+static void hardware(uint8_t reg){
+    uint8_t tx, rx = 0xFF;              // Nadie: pull-up
+
+    prueba_adc();
+    if(ESCRITO){                        // El byte anterior ya termin
+        ESCRITO = 0;
+        tx = XC_REG[XC_SSPBUF];
+        if(!(XC_REG[XC_PORTA] & 0x40)){ // Esclavo 1 en lazo abierto: eco del byte anterior
+            rx = ECO_1;
+            ECO_1 = tx;
+            recibir_1(tx);
+        }
+        else if(!(XC_REG[XC_PORTA] & 0x80)){    // Esclavo 2: dato y su complemento
+            rx = CARGA_2;
+            CARGA_2 = (tx == SPI_LEER) ? (uint8_t)~rx : 0x3C;
+        }
+        XC_REG[XC_SSPBUF] = rx;
+        XC_PONER(SSPSTAT, XC_BF);
+    }
+    if(reg == XC_SSPBUF){
+        if(XC_BIT(SSPSTAT, XC_BF)){     // Lectura de la respuesta
+            XC_QUITAR(SSPSTAT, XC_BF);
+        }
+        else{                           // Escritura: inicia la transferencia
+            ESCRITO = 1;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * PRUEBAS
+ ------------------------------------------------------------------------------*/
+// Reinicio del master (RAM en 0 como tras el arranque) y corrida del ciclo
+// principal con la secuencia s de n muestras
+static void correr(const uint8_t *s, unsigned n){
+    spi_esclavo_t inicial_1 = SPI_ESCLAVO(0x01, SPI_ESPERA_DEFECTO);
+    spi_esclavo_t inicial_2 = SPI_ESCLAVO(0x02, SPI_ESPERA_DEFECTO);
+
+    ESCLAVO_1 = inicial_1;
+    ESCLAVO_2 = inicial_2;
+    LECTURA_POT = ULTIMO_ENVIADO = 0;
+    MUESTRA_NUEVA = 0;
+#if SERVO_RESOLUCION == 12
+    SOBREMUESTREO_SUMA = 0;
+    SOBREMUESTREO_CUENTA = 0;
+#endif
+    FILTRO_LISTO = ENVIO_PENDIENTE = ENVIO_CUENTA = 0;
+    TX_ENVIADOS = TX_OMITIDOS = 0;
+    ECO_CONOCIDO = 0;
+    XC_REG[XC_ADCON0] = 0;
+    PRUEBA_ADC_CUENTA = 0;
+    PRUEBA_EN_ISR = 0;
+
+    ENTRADA = s;
+    N_MUESTRAS = n;
+    CONVERSIONES = ENTREGADAS = N_RECIBIDAS = 0;
+    ESCRITO = 0;
+    prueba_correr_main();
+    PRUEBA_EN_ISR = 0;                  // La corrida puede terminar dentro de la ISR
+    VERIFICAR(ESCLAVO_1.fallos == 0 && ESCLAVO_2.fallos == 0);
+}
+
+static void arranque(void){
+    static uint8_t s[20];
+    unsigned i;
+
+    for(i = 0; i < 20; i++){
+        s[i] = 200;
+    }
+    correr(s, 20);
+    VERIFICAR(N_RECIBIDAS > 0 && RECIBIDAS[0] == ESCALA(200));
+    for(i = 0; i < N_RECIBIDAS; i++){
+        VERIFICAR(RECIBIDAS[i] == ESCALA(200));     // Sin rampa desde 0
+    }
+    for(i = 0; i < 20; i++){
+        VERIFICAR(SALIDA[i] == ESCALA(200));
+    }
+    printf("  Arranque: primer envo %u (muestra %u)\n", (unsigned)RECIBIDAS[0], (unsigned)ESCALA(200));
+}
+
+static void ruido(void){
+    static uint8_t s[MUESTRAS_MAX];
+    servo_t desvio, desvio_iir = 0, y;
+    unsigned i, picos = 0;
+
+    for(i = 0; i < MUESTRAS_MAX; i++){
+        s[i] = (uint8_t)(128 + (int)((i * 37 + 11) % 3) - 1);     // Ruido de +-1
+        if(i % 9 == 4){
+            s[i] = (i % 2) ? 228 : 28;                          // Pico aislado de +-100
+            picos++;
+        }
+    }
+    correr(s, MUESTRAS_MAX);
+    desvio = 0;
+    for(i = 0; i < MUESTRAS_MAX; i++){
+        y = (SALIDA[i] > ESCALA(128)) ? SALIDA[i] - ESCALA(128) : ESCALA(128) - SALIDA[i];
+        desvio = (y > desvio) ? y : desvio;
+    }
+    VERIFICAR(desvio <= ESCALA(1));
+
+    // Misma secuencia solo con el IIR, para comparar
+    sembrar_filtro(ESCALA(s[0]));
+    for(i = 1; i < MUESTRAS_MAX; i++){
+        y = filtro_iir(ESCALA(s[i]));
+        y = (y > ESCALA(128)) ? y - ESCALA(128) : ESCALA(128) - y;
+        desvio_iir = (y > desvio_iir) ? y : desvio_iir;
+    }
+    VERIFICAR(desvio_iir > ESCALA(1));
+    printf("  Ruido +-%u con %u picos: desvo mximo %u (%u sin la mediana)\n",
+           (unsigned)ESCALA(1), picos, (unsigned)desvio, (unsigned)desvio_iir);
+    printf("  Ruido: %u envos en %u muestras, %u bajo el umbral\n",
+           TX_ENVIADOS, MUESTRAS_MAX, TX_OMITIDOS);
+}
+
+static void escalon(void){
+    static uint8_t s[MUESTRAS_MAX];
+    const unsigned inicio = 30;
+    const unsigned limite = 6 * (1u << FILTRO_IIR_K) + (FILTRO_MEDIANA - 1) / 2;
+    unsigned i, latencia = 0, latencia_envio = 0;
+
+    for(i = 0; i < MUESTRAS_MAX; i++){
+        s[i] = (i < inicio) ? 50 : 200;
+    }
+    correr(s, MUESTRAS_MAX);
+    for(i = inicio; i < MUESTRAS_MAX; i++){
+        VERIFICAR(SALIDA[i] >= SALIDA[i-1] && SALIDA[i] <= ESCALA(200));   // Sin sobrepaso
+        if(!latencia && SALIDA[i] + ESCALA(1) >= ESCALA(200)){
+            latencia = i - inicio + 1;
+        }
+    }
+    VERIFICAR(latencia > 0 && latencia <= limite);
+    VERIFICAR(SALIDA[MUESTRAS_MAX-1] == ESCALA(200));
+    for(i = 0; i < N_RECIBIDAS; i++){
+        if(RECIBIDAS[i] + ESCALA(1) >= ESCALA(200)){
+            latencia_envio = RECIBIDAS_MUESTRA[i] - inicio;
+            break;
+        }
+    }
+    VERIFICAR(latencia_envio > 0 && latencia_envio <= limite + 1);
+    printf("  Escaln 50 -> 200: a 1 del final en %u muestras (lmite %u), enviado tras %u\n",
+           latencia, limite, latencia_envio);
+    printf("  Escaln: %u envos en %u muestras, %u bajo el umbral\n",
+           TX_ENVIADOS, MUESTRAS_MAX, TX_OMITIDOS);
+}
+
+int main(void){
+    XC_GANCHO = hardware;
+    XC_TMR1_POR_ACCESO = 0;
+    PRUEBA_ADC = adc;
+
+    printf("postlab-master.c (SERVO_RESOLUCION = %d, mediana de %d, IIR con K = %d, umbral %d)\n",
+           SERVO_RESOLUCION, FILTRO_MEDIANA, FILTRO_IIR_K, FILTRO_UMBRAL);
+    arranque();
+    ruido();
+    escalon();
+
+    return PRUEBA_RESULTADO();
+}
@@ -0,0 +1,290 @@
+/*
+ * File:   prueba-isr-esclavo.c
+ * Author: Pablo Caal
+ *
+ * Tormenta de interrupciones sobre la ISR de un esclavo contador
+ * (lab-slave.c o postlab-slave2.c, se elige con -DPROGRAMA), con el tiempo
+ * contado en ciclos de instruccin (Tcy)
+ *
+ *  El SSP y PORTB se simulan con el gancho de pruebas/xc.h:
+ *  - Cada tramo de la ISR entre dos accesos a SFR cuesta lo de la tabla
+ *    TRAMOS (prueba_costo en prueba.h)
+ *  - El maestro enva la secuencia de lab-master.c (dato, guarda de SS,
+ *    SPI_LEER, pausa, SPI_VERIFICAR, pausa) con 2 * SPI_DIVISOR Tcy por
+ *    byte; postlab-master.c hace lo mismo sin el dato. Las pausas son las
+ *    constantes de spi-maestro.h, sin el cdigo del maestro (solo lo alarga).
+ *  - Un byte pone BF y SSPIF al terminar; si BF sigue puesto se pierde y se
+ *    pone SSPOV, como en el PIC
+ *  - Cambios de RB0/RB1 ponen RBIF cada PERIODO Tcy (1: RBIF de nuevo en
+ *    cuanto se limpia) con todas las fases respecto a los bytes, o a
+ *    intervalos al azar; el ciclo principal vaca la cola cuando la CPU no
+ *    est en la ISR
+ *
+ *  Se verifica que SSPOV nunca ocurre, que el esclavo recarga SSPBUF antes de
+ *  que empiece el siguiente byte (a lo ms SPI_LATENCIA_ESCLAVO_CICLOS despus
+ *  del anterior), que cada SPI_VERIFICAR recibe el complemento y que cada
+ *  RBIF queda en la cola o contado en perdidos. Control: dos bytes sin pausa
+ *  con la ISR ocupada deben dar SSPOV.
+ *
+ *  Los costos son estimaciones con los patrones del .lst de XC8 en modo free
+ *  (entrada de 19 Tcy, bandera en 4-7, cambio de banco en 2, retfie con la
+ *  restauracin en 12), no del listado del programa actual: la comprobacin
+ *  definitiva es MEDIR_LATENCIA = 1 en simulacin.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#include "prueba.h"              // PROGRAMA viene de -DPROGRAMA
+#include "spi-maestro.h"         // Pausas del maestro (el esclavo no lo incluye)
+
+#if MEDIR_LATENCIA
+#error "Compile sin MEDIR_LATENCIA (la tabla TRAMOS es la de la ISR sin medicin)"
+#endif
+
+/*------------------------------------------------------------------------------
+ * COSTOS DE LA ISR
+ ------------------------------------------------------------------------------*/
+// Cota comn de lab-slave.c y postlab-slave2.c (lab-slave tiene la rama de
+// VERIFICANDO, la ms larga)
+static const tramo_t TRAMOS[] = {
+    {TRAMO_ENTRADA, XC_PIR1,      19},    // Latencia 4, contexto 9, ljmp 4, banco 2 hasta btfss SSPIF
+    {XC_PIR1,       XC_SSPBUF,     4},    // SSPIF: btfss salta + goto
+    {XC_PIR1,       XC_INTCON,     6},    // Sin SSPIF (btfss, goto, goto) o tras bcf SSPIF
+    {XC_SSPBUF,     XC_SSPBUF,    20},    // TEMPORAL = SSPBUF, == FLAG_SPI, ENVIADO = CONTADOR, banco 0
+    {XC_SSPBUF,     XC_SSPCON,    18},    // Rama de DATO y VERIFICANDO (lab-slave), banco 0, btfss SSPOV
+    {XC_SSPCON,     XC_SSPCON,     9},    // SSPOV_CONTADOR++ con cambio de banco
+    {XC_SSPCON,     XC_PIR1,       7},    // Sin SSPOV (btfss, goto, goto) o tras bcf SSPOV
+    {XC_INTCON,     XC_PORTB,      7},    // RBIF: btfss salta + goto + banco 0
+    {XC_PORTB,      XC_INTCON,     6},    // EVENTO_ISR = PORTB por el temporal
+    {XC_INTCON,     TRAMO_SALIDA, 40},    // COLA_ENCOLAR con FSR (28) y restauracin (12); sin RBIF 17
+};
+
+#define COSTO(de, a) prueba_costo(TRAMOS, sizeof TRAMOS / sizeof TRAMOS[0], (de), (a))
+
+static unsigned long TIEMPO;        // Tcy desde el inicio de la corrida
+static uint8_t ANTERIOR = TRAMO_FUERA;  // ltimo acceso de la ISR
+
+/*------------------------------------------------------------------------------
+ * HARDWARE SIMULADO
+ ------------------------------------------------------------------------------*/
+#define BYTE_TCY (2 * SPI_DIVISOR)  // Un byte a Fosc/SPI_DIVISOR
+#define BYTES_MAX 64
+
+static unsigned long INICIO[BYTES_MAX];     // Tcy en que el maestro empieza cada byte
+static uint8_t DATO_TX[BYTES_MAX];          // Byte del maestro
+static uint8_t RESPUESTA[BYTES_MAX];        // Lo que el esclavo tena en SSPBUF al empezar
+static unsigned N_BYTES;                    // Bytes programados
+static unsigned EMPEZADOS;                  // Bytes que el maestro ya empez
+static unsigned SIGUIENTE;                  // Siguiente byte por llegar
+static unsigned ULTIMO = BYTES_MAX;         // ltimo byte que lleg (BYTES_MAX: ninguno)
+
+static unsigned long LECTURA_MAX;   // Mayor espera de un byte hasta leer SSPBUF
+static unsigned long RECARGA_MAX;   // Mayor espera de un byte hasta recargar SSPBUF
+static long HOLGURA_LECTURA;        // Menor margen hasta que termina el siguiente byte
+static long HOLGURA_RECARGA;        // Menor margen hasta que empieza el siguiente byte
+
+static unsigned PERIODO;            // Tcy entre cambios de PORTB (0: al azar)
+static unsigned long PROXIMO_RBIF;  // Tcy del siguiente cambio de PORTB
+static unsigned RBIF_GENERADOS;     // Cambios de PORTB que pusieron RBIF
+
+static unsigned long SEMILLA = 12345;
+
+static unsigned azar(unsigned n){
+    SEMILLA = SEMILLA * 1103515245UL + 12345UL;
+    return (unsigned)((SEMILLA >> 16) % n);
+}
+
+#define FIN(i) (INICIO[i] + BYTE_TCY)
+
+static void llega_byte(unsigned i){
+    if(XC_BIT(SSPSTAT, XC_BF)){         // SSPBUF sin leer: el byte se pierde
+        XC_PONER(SSPCON, XC_SSPOV);
+        return;
+    }
+    XC_REG[XC_SSPBUF] = DATO_TX[i];
+    XC_PONER(SSPSTAT, XC_BF);
+    XC_PONER(PIR1, XC_SSPIF);
+    ULTIMO = i;
+}
+
+static void cambia_portb(uint8_t pines){
+    if(!XC_BIT(INTCON, XC_RBIF)){       // Varios cambios seguidos son un solo RBIF
+        RBIF_GENERADOS++;
+    }
+    XC_REG[XC_PORTB] = pines;
+    XC_PONER(INTCON, XC_RBIF);
+}
+
+// Eventos del maestro y de PORTB hasta TIEMPO
+static void avanzar(void){
+    while(EMPEZADOS < N_BYTES && INICIO[EMPEZADOS] <= TIEMPO){
+        RESPUESTA[EMPEZADOS++] = XC_REG[XC_SSPBUF];     // Sale por SDO lo que hay en SSPBUF
+    }
+    while(SIGUIENTE < EMPEZADOS && FIN(SIGUIENTE) <= TIEMPO){
+        llega_byte(SIGUIENTE++);
+    }
+    while(PROXIMO_RBIF <= TIEMPO){
+        cambia_portb((uint8_t)azar(4));
+        PROXIMO_RBIF += PERIODO ? PERIODO : 1 + azar(150);
+    }
+}
+
+static void hardware(uint8_t reg){
+    long holgura;
+
+    if(ANTERIOR == TRAMO_FUERA){        // setup() y pruebas: sin tiempo
+        return;
+    }
+    TIEMPO += COSTO(ANTERIOR, reg);
+    ANTERIOR = reg;
+    avanzar();
+    if(reg != XC_SSPBUF || ULTIMO == BYTES_MAX){
+        return;
+    }
+    if(XC_BIT(SSPSTAT, XC_BF)){         // Lectura de SSPBUF (limpia BF)
+        XC_QUITAR(SSPSTAT, XC_BF);
+        LECTURA_MAX = (TIEMPO - FIN(ULTIMO) > LECTURA_MAX) ? TIEMPO - FIN(ULTIMO) : LECTURA_MAX;
+        if(ULTIMO + 1 < N_BYTES){
+            holgura = (long)FIN(ULTIMO + 1) - (long)TIEMPO;
+            HOLGURA_LECTURA = (holgura < HOLGURA_LECTURA) ? holgura : HOLGURA_LECTURA;
+        }
+    }
+    else{                               // Recarga de SSPBUF
+        RECARGA_MAX = (TIEMPO - FIN(ULTIMO) > RECARGA_MAX) ? TIEMPO - FIN(ULTIMO) : RECARGA_MAX;
+        if(ULTIMO + 1 < N_BYTES){
+            holgura = (long)INICIO[ULTIMO + 1] - (long)TIEMPO;
+            HOLGURA_RECARGA = (holgura < HOLGURA_RECARGA) ? holgura : HOLGURA_RECARGA;
+        }
+    }
+}
+
+static unsigned ENCOLADOS;          // Eventos sacados por la mitad inferior
+static unsigned PERDIDOS;           // Eventos descartados por cola llena (sin desborde)
+
+static void mitad_inferior(void){
+    while(!COLA_VACIA(EVENTOS)){
+        COLA_SACAR(EVENTOS, EVENTO);
+        ENCOLADOS++;
+    }
+    PERDIDOS += EVENTOS.perdidos;       // El contador de la cola es de 8 bits
+    EVENTOS.perdidos = 0;
+}
+
+// La CPU entra a la ISR mientras haya una bandera habilitada (GIE = 1); si
+// no, el ciclo principal corre hasta el siguiente evento
+static void correr(void){
+    unsigned long fin = FIN(N_BYTES - 1) + 1000;
+
+    while(TIEMPO < fin){
+        avanzar();
+        if((XC_BIT(PIR1, XC_SSPIF) && XC_BIT(PIE1, XC_SSPIE)) ||
+           (XC_BIT(INTCON, XC_RBIF) && XC_BIT(INTCON, XC_RBIE))){
+            ANTERIOR = TRAMO_ENTRADA;
+            isr();
+            TIEMPO += COSTO(ANTERIOR, TRAMO_SALIDA);
+            ANTERIOR = TRAMO_FUERA;
+        }
+        else{
+            mitad_inferior();
+            TIEMPO = (PROXIMO_RBIF < fin) ? PROXIMO_RBIF : fin;
+            if(SIGUIENTE < N_BYTES && FIN(SIGUIENTE) < TIEMPO){
+                TIEMPO = FIN(SIGUIENTE);
+            }
+        }
+    }
+    mitad_inferior();
+}
+
+/*------------------------------------------------------------------------------
+ * PRUEBAS
+ ------------------------------------------------------------------------------*/
+static void programar(unsigned long t, uint8_t dato){
+    INICIO[N_BYTES] = t;
+    DATO_TX[N_BYTES++] = dato;
+}
+
+// Ciclos de lab-master.c: dato, guarda, SPI_LEER, pausa, SPI_VERIFICAR, pausa
+static void reinicio(unsigned periodo, unsigned fase, unsigned vueltas, unsigned long pausa){
+    unsigned long t = 50;
+    unsigned v;
+
+    setup();
+    SSPOV_CONTADOR = 0;
+    EVENTOS.entrada = EVENTOS.salida = EVENTOS.perdidos = 0;
+    RBIF_GENERADOS = ENCOLADOS = PERDIDOS = 0;
+    XC_REG[XC_PORTB] = 0b11;            // Botones sueltos (pull-ups)
+    TIEMPO = 0;
+    PERIODO = periodo;
+    PROXIMO_RBIF = fase;
+    N_BYTES = EMPEZADOS = SIGUIENTE = 0;
+    ULTIMO = BYTES_MAX;
+    for(v = 0; v < vueltas; v++){
+        programar(t, (uint8_t)(v & 0x7F));
+        t += BYTE_TCY + SPI_GUARDA_SS_CICLOS;
+        programar(t, SPI_LEER);
+        t += BYTE_TCY + pausa;
+        programar(t, SPI_VERIFICAR);
+        t += BYTE_TCY + pausa;
+    }
+}
+
+static void revisar(void){
+    unsigned i;
+
+    VERIFICAR(SSPOV_CONTADOR == 0);
+    VERIFICAR(SIGUIENTE == N_BYTES);
+    VERIFICAR(ENCOLADOS + PERDIDOS == RBIF_GENERADOS);
+    for(i = 2; i < N_BYTES; i += 3){    // SPI_VERIFICAR recibe el complemento
+        VERIFICAR((RESPUESTA[i] ^ RESPUESTA[i-1]) == 0xFF);
+    }
+}
+
+static void tormenta(void){
+    static const unsigned periodos[] = {1, 37, 64, 101};
+    unsigned p, fase, corridas = 0, rbif = 0;
+
+    LECTURA_MAX = RECARGA_MAX = 0;
+    HOLGURA_LECTURA = HOLGURA_RECARGA = 1000000L;
+    for(p = 0; p < sizeof periodos / sizeof periodos[0]; p++){
+        for(fase = 0; fase < periodos[p]; fase++){
+            reinicio(periodos[p], fase, 3, SPI_LATENCIA_ESCLAVO_CICLOS);
+            correr();
+            revisar();
+            rbif += RBIF_GENERADOS;
+            corridas++;
+        }
+    }
+    for(fase = 0; fase < 200; fase++){  // Cambios de PORTB al azar
+        reinicio(0, azar(150), 20, SPI_LATENCIA_ESCLAVO_CICLOS);
+        correr();
+        revisar();
+        rbif += RBIF_GENERADOS;
+        corridas++;
+    }
+    VERIFICAR(PRUEBA_SIN_COSTO == 0);
+    VERIFICAR(RECARGA_MAX <= SPI_LATENCIA_ESCLAVO_CICLOS);
+    VERIFICAR(HOLGURA_RECARGA >= 0 && HOLGURA_LECTURA > 0);
+    printf("  %u corridas, %u RBIF: SSPOV = %u\n", corridas, rbif, SSPOV_CONTADOR);
+    printf("  Byte -> lectura de SSPBUF: %lu Tcy (margen %ld hasta el fin del siguiente)\n",
+           LECTURA_MAX, HOLGURA_LECTURA);
+    printf("  Byte -> recarga de SSPBUF: %lu Tcy de SPI_LATENCIA_ESCLAVO_CICLOS = %d (margen %ld)\n",
+           RECARGA_MAX, SPI_LATENCIA_ESCLAVO_CICLOS, HOLGURA_RECARGA);
+}
+
+static void control_sspov(void){
+    reinicio(1, 0, 1, 0);               // Sin pausa y con la ISR siempre ocupada
+    correr();
+    VERIFICAR(SSPOV_CONTADOR > 0);
+    VERIFICAR(!XC_BIT(SSPCON, XC_SSPOV));
+}
+
+int main(void){
+    XC_GANCHO = hardware;
+    XC_TMR1_POR_ACCESO = 0;
+
+    printf("%s (SCK = Fosc/%d: un byte dura %d Tcy)\n", PROGRAMA, SPI_DIVISOR, BYTE_TCY);
+    tormenta();
+    control_sspov();
+
+    return PRUEBA_RESULTADO();
+}
@@ -0,0 +1,271 @@
+/*
+ * File:   prueba-isr-servo.c
+ * Author: Pablo Caal
+ *
+ * Latencia de la ISR de postlab-slave1.c contra SERVO_LATENCIA_ISR_CICLOS,
+ * con el tiempo contado en ciclos de instruccin (Tcy). Se compila con
+ * -DSERVO_RESOLUCION y -DLAZO_CERRADO.
+ *
+ *  El SSP, el CCP1 y el ADC se simulan con el gancho de pruebas/xc.h:
+ *  - Cada tramo de la ISR entre dos accesos a SFR cuesta lo de la tabla
+ *    TRAMOS (prueba_costo en prueba.h)
+ *  - TMR1 es el tiempo (Fosc/4); CCP1IF se pone cuando TMR1 llega a CCPR1,
+ *    con el pulso inicial de setup() (OUT_MIN)
+ *  - En lazo cerrado GO termina 11 TAD despus con ADIF
+ *  - El maestro enva la posicin como postlab-master.c: con 2 bytes, el
+ *    bajo empieza SERVO_PAUSA_CICLOS despus del alto (sin el cdigo del
+ *    maestro, que solo alarga la pausa)
+ *
+ *  El byte alto (o el nico) llega en cada Tcy alrededor de la subida y de
+ *  la bajada del pulso. Se verifica que SSPOV nunca ocurre, que la posicin
+ *  llega completa y que la mayor espera hasta leer SSPBUF ms el tramo con
+ *  GIE apagado del ciclo principal (VENTANA_GIE) no pasa de
+ *  SERVO_LATENCIA_ISR_CICLOS. Control: sin pausa el byte bajo da SSPOV.
+ *
+ *  Los costos son estimaciones con los patrones del .lst de XC8 en modo free
+ *  (igual que en prueba-isr-esclavo.c); la comprobacin definitiva es
+ *  MEDIR_LATENCIA = 1 en simulacin.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#define PROGRAMA "postlab-slave1.c"
+#include "prueba.h"
+
+#if MEDIR_LATENCIA
+#error "Compile sin MEDIR_LATENCIA (la tabla TRAMOS es la de la ISR sin medicin)"
+#endif
+
+/*------------------------------------------------------------------------------
+ * COSTOS DE LA ISR
+ ------------------------------------------------------------------------------*/
+// Tramo ms largo del ciclo principal con GIE apagado: copia de REFERENCIA
+// (16 bits, volatile) en leer_referencia(); fijar_pulso() es ms corto
+#define VENTANA_GIE 12
+
+static const tramo_t TRAMOS[] = {
+    {TRAMO_ENTRADA, XC_PIR1,      19},    // Latencia 4, contexto 9, ljmp 4, banco 2 hasta btfss SSPIF
+    {XC_PIR1,       XC_SSPBUF,     4},    // SSPIF: btfss salta + goto
+    {XC_PIR1,       XC_PIR1,       6},    // Bandera en falso (btfss, goto, goto) o bcf y siguiente bandera
+    {XC_PIR1,       XC_CCP1CON,    4},    // CCP1IF: btfss salta + goto
+    {XC_PIR1,       TRAMO_SALIDA, 17},    // ltima bandera en falso y restauracin (12)
+    {XC_SSPCON,     XC_SSPCON,     9},    // SSPOV_CONTADOR++ con cambio de banco
+#if SERVO_BYTES == 1
+    {XC_SSPCON,     XC_PIR1,      15},    // Sin SSPOV, REFERENCIA = TEMPORAL, REFERENCIA_NUEVA = 1
+#else
+    {XC_SSPCON,     XC_PIR1,      90},    // Byte bajo: BYTE_ALTO << 7 en 16 bits (7 vueltas de rlf), REFERENCIA
+#endif
+    {XC_CCP1CON,    XC_CCP1CON,   26},    // Subida: PULSO_TRAMA = PULSO, FLANCO += (16 bits)
+    {XC_CCP1CON,    XC_CCPR1H,     9},    // FLANCO >> 8 con cambio de banco
+    {XC_CCPR1H,     XC_CCPR1L,     7},    // (uint8_t)FLANCO con cambio de banco
+#if LAZO_CERRADO
+    {XC_SSPBUF,     XC_SSPBUF,     9},    // TEMPORAL = SSPBUF, SSPBUF = POSICION
+    {XC_SSPBUF,     XC_SSPCON,     2},    // btfss SSPOV
+    {XC_CCPR1L,     XC_CCP1CON,    2},    // Inicio de trama?
+    {XC_CCP1CON,    XC_ADCON0,    32},    // TRAMA_INICIO (16 bits), PI_TICKS++, PI_DIVISOR_CONTADOR
+    {XC_CCP1CON,    XC_PIR1,      30},    // Inicio de trama sin GO (PI_DIVISOR > 1) o bajada
+    {XC_ADCON0,     XC_PIR1,       4},    // bsf GO, bcf CCP1IF
+    {XC_PIR1,       XC_ADRESH,     4},    // ADIF: btfss salta + goto
+    {XC_ADRESH,     XC_PIR1,      10},    // POSICION = ADRESH, PI_PENDIENTE = 1
+#else
+    {XC_SSPBUF,     XC_SSPCON,     8},    // TEMPORAL = SSPBUF por el temporal, banco 0
+    {XC_CCPR1L,     XC_PIR1,       2},    // bcf CCP1IF
+#endif
+};
+
+#define COSTO(de, a) prueba_costo(TRAMOS, sizeof TRAMOS / sizeof TRAMOS[0], (de), (a))
+
+static unsigned long TIEMPO;        // Tcy desde setup() (TMR1 = TIEMPO)
+static uint8_t ANTERIOR = TRAMO_FUERA;  // ltimo acceso de la ISR
+
+/*------------------------------------------------------------------------------
+ * HARDWARE SIMULADO
+ ------------------------------------------------------------------------------*/
+#define BYTE_TCY (2 * SPI_DIVISOR)  // Un byte a Fosc/SPI_DIVISOR
+#if LAZO_CERRADO
+#define ADC_TCY ((11 * ADCS_DIVISOR_DE(CFG_ADC_ADCS) + 3) / 4)     // 11 TAD
+#endif
+
+static unsigned long INICIO[2];     // Tcy en que el maestro empieza cada byte
+static uint8_t DATO_TX[2];          // Bytes de la posicin
+static unsigned N_BYTES;            // Bytes programados
+static unsigned SIGUIENTE;          // Siguiente byte por llegar
+static unsigned ULTIMO;             // ltimo byte que lleg (N_BYTES: ninguno)
+
+static unsigned long CCP_VISTO;     // TMR1 ya revisado contra CCPR1
+static unsigned long ADC_FIN;       // Tcy en que termina la conversin (0: ninguna)
+static unsigned long LECTURA_MAX;   // Mayor espera de un byte hasta leer SSPBUF
+static unsigned long CORRIDAS;
+
+#define FIN(i) (INICIO[i] + BYTE_TCY)
+
+// Tcy del siguiente TMR1 == CCPR1 despus de t
+static unsigned long coincidencia(unsigned long t){
+    uint16_t ccpr = (uint16_t)((XC_REG[XC_CCPR1H] << 8) | XC_REG[XC_CCPR1L]);
+    return t + 1 + (uint16_t)(ccpr - (uint16_t)(t + 1));
+}
+
+static void llega_byte(unsigned i){
+    if(XC_BIT(SSPSTAT, XC_BF)){         // SSPBUF sin leer: el byte se pierde
+        XC_PONER(SSPCON, XC_SSPOV);
+        return;
+    }
+    XC_REG[XC_SSPBUF] = DATO_TX[i];
+    XC_PONER(SSPSTAT, XC_BF);
+    XC_PONER(PIR1, XC_SSPIF);
+    ULTIMO = i;
+}
+
+// Eventos del maestro, del CCP1 y del ADC hasta TIEMPO
+static void avanzar(void){
+    unsigned long t;
+
+    while(SIGUIENTE < N_BYTES && FIN(SIGUIENTE) <= TIEMPO){
+        llega_byte(SIGUIENTE++);
+    }
+    while(CCP_VISTO < TIEMPO){
+        t = coincidencia(CCP_VISTO);
+        if(t > TIEMPO){
+            CCP_VISTO = TIEMPO;
+        }
+        else{
+            XC_PONER(PIR1, XC_CCP1IF);
+            CCP_VISTO = t;
+        }
+    }
+#if LAZO_CERRADO
+    if(XC_BIT(ADCON0, XC_GO) && !ADC_FIN){
+        ADC_FIN = TIEMPO + ADC_TCY;
+    }
+    if(ADC_FIN && ADC_FIN <= TIEMPO){
+        XC_REG[XC_ADRESH] = 0x80;
+        XC_QUITAR(ADCON0, XC_GO);
+        XC_PONER(PIR1, XC_ADIF);
+        ADC_FIN = 0;
+    }
+#endif
+}
+
+static void hardware(uint8_t reg){
+    if(ANTERIOR == TRAMO_FUERA){        // setup() y pruebas: sin tiempo
+        return;
+    }
+    TIEMPO += COSTO(ANTERIOR, reg);
+    ANTERIOR = reg;
+    avanzar();
+    if(reg == XC_SSPBUF && XC_BIT(SSPSTAT, XC_BF) && ULTIMO < N_BYTES){    // Lectura (limpia BF)
+        XC_QUITAR(SSPSTAT, XC_BF);
+        if(TIEMPO - FIN(ULTIMO) > LECTURA_MAX){
+            LECTURA_MAX = TIEMPO - FIN(ULTIMO);
+        }
+    }
+}
+
+// La CPU entra a la ISR mientras haya una bandera habilitada (GIE = 1); si
+// no, el ciclo principal corre hasta el siguiente evento
+static void correr(void){
+    unsigned long fin = FIN(N_BYTES - 1) + 600, t;
+
+    while(TIEMPO < fin){
+        avanzar();
+        if((XC_REG[XC_PIR1] & XC_REG[XC_PIE1]) != 0){
+            ANTERIOR = TRAMO_ENTRADA;
+            isr();
+            TIEMPO += COSTO(ANTERIOR, TRAMO_SALIDA);
+            ANTERIOR = TRAMO_FUERA;
+        }
+        else{
+            t = coincidencia(CCP_VISTO);
+            TIEMPO = (t < fin) ? t : fin;
+            if(SIGUIENTE < N_BYTES && FIN(SIGUIENTE) < TIEMPO){
+                TIEMPO = FIN(SIGUIENTE);
+            }
+            if(ADC_FIN && ADC_FIN < TIEMPO){
+                TIEMPO = ADC_FIN;
+            }
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * PRUEBAS
+ ------------------------------------------------------------------------------*/
+// Reinicio del esclavo y posicin que termina de llegar (byte alto) en llegada
+static void reinicio(unsigned long llegada, unsigned long pausa, servo_t valor){
+    setup();
+    SSPOV_CONTADOR = 0;
+    REFERENCIA = 0;
+    REFERENCIA_NUEVA = 0;
+#if SERVO_BYTES == 2
+    ALTO_VALIDO = 0;
+#endif
+#if LAZO_CERRADO
+    PI_DIVISOR_CONTADOR = 0;
+#endif
+    TIEMPO = CCP_VISTO = ADC_FIN = 0;
+    N_BYTES = SIGUIENTE = 0;
+#if SERVO_BYTES == 1
+    (void)pausa;
+    DATO_TX[N_BYTES] = valor;
+    INICIO[N_BYTES++] = llegada - BYTE_TCY;
+#else
+    DATO_TX[N_BYTES] = SERVO_BYTE_ALTO(valor);
+    INICIO[N_BYTES++] = llegada - BYTE_TCY;
+    DATO_TX[N_BYTES] = SERVO_BYTE_BAJO(valor);
+    INICIO[N_BYTES++] = llegada + pausa;
+#endif
+    ULTIMO = N_BYTES;
+}
+
+static void alrededor_de_flancos(void){
+    const unsigned long flancos[] = {CFG_SERVO_TRAMA_CICLOS, CFG_SERVO_TRAMA_CICLOS + OUT_MIN};
+    unsigned f;
+    long d;
+    servo_t valor;
+
+    LECTURA_MAX = 0;
+    for(f = 0; f < 2; f++){
+        for(d = -(long)SERVO_LATENCIA_ISR_CICLOS - 100; d <= 100; d++){
+            valor = (servo_t)((CORRIDAS * 37) & SERVO_MAX);
+            reinicio(flancos[f] + d, SERVO_PAUSA_CICLOS, valor);
+            correr();
+            VERIFICAR(SSPOV_CONTADOR == 0);
+            VERIFICAR(REFERENCIA_NUEVA && REFERENCIA == valor);
+            CORRIDAS++;
+        }
+    }
+    VERIFICAR(PRUEBA_SIN_COSTO == 0);
+    VERIFICAR(LECTURA_MAX + VENTANA_GIE <= SERVO_LATENCIA_ISR_CICLOS);
+    printf("  %lu corridas alrededor de la subida y la bajada del pulso: SSPOV = 0\n", CORRIDAS);
+    printf("  Byte -> lectura de SSPBUF: %lu Tcy + %d con GIE apagado = %lu de SERVO_LATENCIA_ISR_CICLOS = %d (margen %ld)\n",
+           LECTURA_MAX, VENTANA_GIE, LECTURA_MAX + VENTANA_GIE, SERVO_LATENCIA_ISR_CICLOS,
+           (long)SERVO_LATENCIA_ISR_CICLOS - (long)(LECTURA_MAX + VENTANA_GIE));
+}
+
+#if SERVO_BYTES == 2
+static void control_sspov(void){
+    long d;
+    unsigned desbordes = 0;
+
+    for(d = 0; d <= 100; d++){          // Sin pausa, el byte alto llega con la rama del CCP1 en curso
+        reinicio(CFG_SERVO_TRAMA_CICLOS + d, 0, 0x155);
+        correr();
+        desbordes += SSPOV_CONTADOR;
+    }
+    VERIFICAR(desbordes > 0);
+}
+#endif
+
+int main(void){
+    XC_GANCHO = hardware;
+    XC_TMR1_POR_ACCESO = 0;
+
+    printf("postlab-slave1.c (SERVO_RESOLUCION = %d, %s, SCK = Fosc/%d)\n", SERVO_RESOLUCION,
+           LAZO_CERRADO ? "lazo cerrado" : "lazo abierto", SPI_DIVISOR);
+    alrededor_de_flancos();
+#if SERVO_BYTES == 2
+    control_sspov();
+#endif
+
+    return PRUEBA_RESULTADO();
+}
@@ -0,0 +1,266 @@
+/*
+ * File:   prueba-spi-maestro.c
+ * Author: Pablo Caal
+ *
+ * Fallas del bus SPI vistas desde postlab-master.c (spi-maestro.h) en lazo
+ * abierto, con SSP y esclavos simulados en el gancho de pruebas/xc.h:
+ *  - El maestro escribe SSPBUF y en el siguiente acceso a un SFR el byte ya
+ *    sali: cada esclavo con SS en bajo (RA6 -> esclavo 1, RA7 -> esclavo 2)
+ *    lo recibe y el primero con SDO como salida responde; BF se pone aunque
+ *    no responda nadie (pull-up, 0xFF)
+ *  - SDO de cada esclavo segn el CFG_TRISC de su programa (TRISC_ESCLAVO_1
+ *    y TRISC_ESCLAVO_2, los extrae el Makefile): un esclavo con SDO como
+ *    entrada recibe pero no maneja la lnea
+ *  - Esclavo 2 sano: misma regla que postlab-slave2.c (SPI_LEER -> ~dato)
+ *  - Esclavo 1 sano en lazo abierto: devuelve el eco del byte anterior
+ *  - Fallas: lnea flotante en alto o en bajo, esclavo trabado (solo eco) y
+ *    SSP del maestro sin reloj (BF nunca llega)
+ *  - Un esclavo seleccionado con SDO como salida maneja MISO aunque no haya
+ *    reloj: dos esclavos as con SS en bajo a la vez es un conflicto en MISO
+ *
+ *  Se verifica que cada falla del esclavo se detecta por la respuesta, que
+ *  el esclavo se marca cado y se omite hasta el reintento, que se recupera,
+ *  que el SSP trabado se reinicia y que un esclavo cado no afecta al otro.
+ *  Con el ciclo principal real (setup y main) se verifica que nunca hay dos
+ *  esclavos seleccionados manejando MISO y que ambos reciben sus bytes.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#define PROGRAMA "postlab-master.c"
+#include "prueba.h"
+
+#if !defined(TRISC_ESCLAVO_1) || !defined(TRISC_ESCLAVO_2)
+#error "Compile con -DTRISC_ESCLAVO_1 y -DTRISC_ESCLAVO_2 (CFG_TRISC de cada esclavo)"
+#endif
+
+/*------------------------------------------------------------------------------
+ * HARDWARE SIMULADO
+ ------------------------------------------------------------------------------*/
+enum { SANO, FLOTANTE_ALTO, FLOTANTE_BAJO, TRABADO };
+
+static uint8_t MODO_1 = SANO;       // Estado del esclavo 1 (servo, lazo abierto)
+static uint8_t MODO_2 = SANO;       // Estado del esclavo 2 (contador)
+static uint8_t SSP_SIN_RELOJ;       // Falla del SSP del maestro
+static uint8_t ESCRITO;             // SSPBUF escrito, el byte sale en el siguiente acceso
+static unsigned BYTES;              // Bytes que salieron al bus
+static unsigned BYTES_1;            // Bytes recibidos por el esclavo 1
+static unsigned BYTES_2;            // Bytes recibidos por el esclavo 2
+static unsigned BYTES_LIMITE;       // Bytes tras los que termina el ciclo principal (0: no corre)
+static unsigned long CONFLICTOS;    // Accesos con dos esclavos manejando MISO
+
+static uint8_t ECO_1;               // SSPSR del esclavo 1 (ltimo byte recibido)
+static uint8_t ECO_2;               // SSPSR del esclavo 2 (ltimo byte recibido)
+static uint8_t CARGA_2;             // SSPBUF cargado por la ISR del esclavo 2
+static uint8_t ENVIADO_2;           // Contador entregado en la ltima lectura
+static uint8_t CONTADOR_2 = 0x3C;   // Contador del esclavo 2
+
+// Byte recibido por un esclavo seleccionado; regresa lo que pone en SDO o -1
+// si SDO es entrada (no maneja la lnea)
+static int esclavo(uint8_t modo, uint8_t trisc, uint8_t *eco, uint8_t tx, int contador){
+    uint8_t rx;
+
+    switch(modo){
+    case FLOTANTE_ALTO:
+        return 0xFF;
+    case FLOTANTE_BAJO:
+        return 0x00;
+    }
+    if(modo == TRABADO || !contador){   // Sin recarga de SSPBUF: sale el byte anterior
+        rx = *eco;
+    }
+    else{                               // Regla de postlab-slave2.c
+        rx = CARGA_2;
+        if(tx == SPI_LEER){
+            CARGA_2 = (uint8_t)~ENVIADO_2;
+        }
+        else{
+            ENVIADO_2 = CONTADOR_2;
+            CARGA_2 = ENVIADO_2;
+        }
+    }
+    *eco = tx;                          // SSPSR queda con el byte recibido
+    return (trisc & TRISC_SDO) ? -1 : rx;
+}
+
+static void hardware(uint8_t reg){
+    int rx = -1, r;
+
+    prueba_adc();                       // Potencimetro fijo (pot_fijo) en el ciclo principal
+
+    // SS en bajo y SDO como salida: el esclavo maneja MISO, haya reloj o no
+    if(!(XC_REG[XC_TRISA] & 0xC0) && !(XC_REG[XC_PORTA] & 0xC0) &&
+       !(TRISC_ESCLAVO_1 & TRISC_SDO) && !(TRISC_ESCLAVO_2 & TRISC_SDO)){
+        CONFLICTOS++;
+    }
+    if(ESCRITO){                        // El byte anterior ya termin
+        ESCRITO = 0;
+        if(!SSP_SIN_RELOJ && XC_BIT(SSPCON, XC_SSPEN)){
+            if(!(XC_REG[XC_PORTA] & 0x40)){
+                rx = esclavo(MODO_1, TRISC_ESCLAVO_1, &ECO_1, XC_REG[XC_SSPBUF], 0);
+                BYTES_1++;
+            }
+            if(!(XC_REG[XC_PORTA] & 0x80)){
+                r = esclavo(MODO_2, TRISC_ESCLAVO_2, &ECO_2, XC_REG[XC_SSPBUF], 1);
+                rx = (rx < 0) ? r : rx;
+                BYTES_2++;
+            }
+            XC_REG[XC_SSPBUF] = (uint8_t)((rx < 0) ? 0xFF : rx);    // Nadie: pull-up
+            XC_PONER(SSPSTAT, XC_BF);
+            BYTES++;
+        }
+    }
+    if(reg == XC_SSPBUF){
+        if(XC_BIT(SSPSTAT, XC_BF)){     // Lectura de la respuesta
+            XC_QUITAR(SSPSTAT, XC_BF);
+        }
+        else{                           // Escritura: inicia la transferencia
+            ESCRITO = 1;
+        }
+    }
+    if(BYTES_LIMITE && BYTES >= BYTES_LIMITE){
+        prueba_salir();                 // Fin de la corrida del ciclo principal
+    }
+}
+
+static uint16_t pot_fijo(void){
+    return 0x200;                       // Potencimetro a la mitad
+}
+
+// SS como lo maneja el ciclo principal: solo el esclavo n en bajo
+static void selecciona(int n){
+    XC_REG[XC_PORTA] = (uint8_t)((XC_REG[XC_PORTA] | 0xC0) & (n == 1 ? ~0x40 : ~0x80));
+}
+
+/*------------------------------------------------------------------------------
+ * PRUEBAS
+ ------------------------------------------------------------------------------*/
+static void reinicio(void){
+    spi_esclavo_t inicial_1 = SPI_ESCLAVO(0x01, SPI_ESPERA_DEFECTO);
+    spi_esclavo_t inicial_2 = SPI_ESCLAVO(0x02, SPI_ESPERA_DEFECTO);
+
+    ESCLAVO_1 = inicial_1;
+    ESCLAVO_2 = inicial_2;
+    MODO_1 = MODO_2 = SANO;
+    SSP_SIN_RELOJ = 0;
+    LECTURA_POT = 0;
+    ULTIMO_BYTE_1 = 0;
+    ECO_CONOCIDO = 0;
+    CONFLICTOS = 0;
+    setup();                            // SS1 y SS2 en alto
+}
+
+static void esclavo_2_sano(void){
+    static const uint8_t valores[] = {0x00, 0x3C, 0x55, 0xAA, 0xFF};
+    unsigned i;
+
+    reinicio();
+    selecciona(2);
+    for(i = 0; i < sizeof valores; i++){
+        CONTADOR_2 = valores[i];
+        VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);  // Entrega el valor anterior
+        VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);
+        VERIFICAR(RESPUESTA == valores[i]);
+    }
+    VERIFICAR(ESCLAVO_2.fallos == 0 && ESCLAVO_2.sin_respuesta == 0);
+}
+
+static void esclavo_2_falla(uint8_t modo){
+    unsigned i, intentos = 0;
+
+    reinicio();
+    selecciona(2);
+    VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);
+    MODO_2 = modo;
+    for(i = 0; i < SPI_FALLOS_MAX; i++){
+        VERIFICAR(spi_disponible(&ESCLAVO_2));
+        VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_SIN_RESPUESTA);
+    }
+    VERIFICAR(ESCLAVO_2.fallos == SPI_FALLOS_MAX);
+    VERIFICAR(ESCLAVO_2.sin_respuesta == SPI_FALLOS_MAX && ESCLAVO_2.timeouts == 0);
+    for(i = 0; i < SPI_REINTENTO; i++){         // Cado: un intento cada SPI_REINTENTO ciclos
+        intentos += spi_disponible(&ESCLAVO_2);
+    }
+    VERIFICAR(intentos == 1);
+
+    MODO_2 = SANO;                              // Vuelve: el reintento lo recupera
+    VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);
+    VERIFICAR(ESCLAVO_2.fallos == 0 && spi_disponible(&ESCLAVO_2));
+}
+
+static void ssp_trabado(void){
+    reinicio();
+    selecciona(2);
+    SSP_SIN_RELOJ = 1;
+    VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_TIMEOUT);
+    VERIFICAR(ESCLAVO_2.timeouts == 1 && ESCLAVO_2.fallos == 1);
+    VERIFICAR(XC_REG[XC_SSPCON] == SSPCON_MAESTRO_VALOR && !XC_BIT(SSPSTAT, XC_BF));
+    SSP_SIN_RELOJ = 0;
+    VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);
+    VERIFICAR(ESCLAVO_2.fallos == 0);
+}
+
+static void esclavo_1_eco(void){
+    unsigned i, bytes;
+
+    reinicio();
+    selecciona(1);
+    for(i = 0; i < 20; i++){
+        VERIFICAR(enviar_posicion((servo_t)(i * 13 + 1)) == SPI_OK);
+    }
+    VERIFICAR(ESCLAVO_1.fallos == 0);
+
+    MODO_1 = FLOTANTE_ALTO;                     // Esclavo 1 desconectado
+    for(i = 0; i < SPI_FALLOS_MAX; i++){
+        VERIFICAR(enviar_posicion((servo_t)(i + 0x10)) == SPI_SIN_RESPUESTA);
+    }
+    VERIFICAR(ESCLAVO_1.fallos == SPI_FALLOS_MAX);
+
+    // El esclavo 1 cado no ocupa el bus ni afecta al esclavo 2
+    bytes = BYTES;
+    for(i = 0; i < SPI_REINTENTO - 1; i++){
+        selecciona(1);
+        if(spi_disponible(&ESCLAVO_1)){
+            enviar_posicion(0x20);
+        }
+        selecciona(2);
+        VERIFICAR(spi_leer(&ESCLAVO_2, &RESPUESTA) == SPI_OK);
+    }
+    VERIFICAR(BYTES - bytes == 2 * (SPI_REINTENTO - 1));
+    VERIFICAR(ESCLAVO_2.fallos == 0);
+}
+
+static void ciclo_principal(void){
+    reinicio();
+    VERIFICAR((XC_REG[XC_PORTA] & 0xC0) == 0xC0);  // Ningn esclavo seleccionado tras setup
+    BYTES_1 = BYTES_2 = 0;
+    BYTES_LIMITE = BYTES + 400;
+    PRUEBA_ADC = pot_fijo;
+    prueba_correr_main();
+    PRUEBA_ADC = 0;
+    BYTES_LIMITE = 0;
+
+    VERIFICAR(CONFLICTOS == 0);
+    VERIFICAR(BYTES_1 > 0 && BYTES_2 > 0);
+    VERIFICAR(BYTES_1 + BYTES_2 == 400);        // Cada byte lleg a un solo esclavo
+    VERIFICAR(ESCLAVO_1.fallos == 0 && ESCLAVO_2.fallos == 0);
+    VERIFICAR(XC_REG[XC_PORTD] == CONTADOR_2);
+    printf("  Ciclo principal: %u bytes al esclavo 1, %u al esclavo 2, %lu accesos con conflicto en MISO\n",
+           BYTES_1, BYTES_2, CONFLICTOS);
+}
+
+int main(void){
+    XC_GANCHO = hardware;
+    XC_TMR1_POR_ACCESO = 0;
+
+    printf("postlab-master.c (SERVO_RESOLUCION = %d, lazo abierto)\n", SERVO_RESOLUCION);
+    esclavo_2_sano();
+    esclavo_2_falla(FLOTANTE_ALTO);
+    esclavo_2_falla(FLOTANTE_BAJO);
+    esclavo_2_falla(TRABADO);
+    ssp_trabado();
+    esclavo_1_eco();
+    ciclo_principal();
+
+    return PRUEBA_RESULTADO();
+}
@@ -0,0 +1,146 @@
+/*
+ * File:   prueba.h
+ * Author: Pablo Caal
+ *
+ * Base comn de las pruebas en el host (make pruebas)
+ *  - Incluye el programa PROGRAMA con main renombrado a programa_main, as
+ *    la prueba llama a setup(), isr() y las funciones del programa y tiene
+ *    su propio main
+ *  - VERIFICAR(cond) imprime la condicin que fall y la cuenta en FALLAS
+ *  - PRUEBA_RESULTADO() imprime OK o FALLA y da el cdigo de salida
+ *  - prueba_correr_main() corre el ciclo principal del programa (while(1))
+ *    hasta que el hardware simulado llame a prueba_salir()
+ *  - prueba_adc() simula el ADC y la entrada a la ISR por ADIF; se llama
+ *    desde el gancho de la prueba con PRUEBA_ADC asignado
+ *  - prueba_costo() da el costo en Tcy de un tramo de la ISR segn la tabla
+ *    de la prueba (tramo_t)
+ *
+ * Uso (PROGRAMA tambin puede venir de -DPROGRAMA='"<programa>.c"'):
+ *  #define PROGRAMA "postlab-master.c"
+ *  #include "prueba.h"
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef PRUEBA_H
+#define	PRUEBA_H
+
+#include <stdio.h>
+#include <setjmp.h>
+
+#ifndef PROGRAMA
+#error "Defina PROGRAMA (\"<programa>.c\") antes de incluir prueba.h"
+#endif
+
+#define main programa_main
+#include PROGRAMA
+#undef main
+
+/*------------------------------------------------------------------------------
+ * VERIFICACIONES
+ ------------------------------------------------------------------------------*/
+static int FALLAS;                  // Verificaciones que fallaron
+
+#define VERIFICAR(cond) do{                                                 \
+        if(!(cond)){                                                        \
+            printf("  FALLA %s:%d: %s\n", __FILE__, __LINE__, #cond);       \
+            FALLAS++;                                                       \
+        }                                                                   \
+    }while(0)
+
+// Resultado de la prueba: imprime OK o FALLA y regresa el cdigo de salida
+#define PRUEBA_RESULTADO()  (printf("%s\n", FALLAS ? "FALLA" : "OK"), FALLAS != 0)
+
+/*------------------------------------------------------------------------------
+ * CICLO PRINCIPAL
+ ------------------------------------------------------------------------------*/
+static jmp_buf PRUEBA_SALIDA;       // Regreso de prueba_salir()
+
+static void prueba_correr_main(void){
+    if(setjmp(PRUEBA_SALIDA) == 0){
+        programa_main();
+    }
+}
+
+// Solo desde el gancho de pruebas/xc.h mientras corre prueba_correr_main()
+static void prueba_salir(void){
+    longjmp(PRUEBA_SALIDA, 1);
+}
+
+/*------------------------------------------------------------------------------
+ * ADC SIMULADO
+ ------------------------------------------------------------------------------*/
+#define PRUEBA_ADC_ACCESOS 8        // Accesos a SFR que dura una conversin
+
+static uint16_t (*PRUEBA_ADC)(void);    // Resultado de 10 bits de cada conversin
+static uint8_t PRUEBA_ADC_CUENTA;       // Accesos restantes de la conversin en curso
+static uint8_t PRUEBA_EN_ISR;           // La ISR ya est corriendo (no se vuelve a entrar)
+
+// Una conversin iniciada con GO termina PRUEBA_ADC_ACCESOS accesos despus
+// (la ISR alcanza a limpiar ADIF antes de la siguiente), deja el resultado
+// segn ADFM y pone ADIF; con ADIE, PEIE y GIE la CPU entra a la ISR entre
+// dos accesos del ciclo principal
+static void prueba_adc(void){
+    uint16_t v;
+
+    if(PRUEBA_ADC && XC_BIT(ADCON0, XC_GO)){
+        if(PRUEBA_ADC_CUENTA == 0){
+            PRUEBA_ADC_CUENTA = PRUEBA_ADC_ACCESOS;
+        }
+        else if(--PRUEBA_ADC_CUENTA == 0){
+            v = PRUEBA_ADC() & 0x3FF;
+            if(XC_BIT(ADCON1, XC_ADFM)){    // Derecha: ADRESH:ADRESL = 000000xx xxxxxxxx
+                XC_REG[XC_ADRESH] = (uint8_t)(v >> 8);
+                XC_REG[XC_ADRESL] = (uint8_t)v;
+            }
+            else{                           // Izquierda: ADRESH = 8 bits altos
+                XC_REG[XC_ADRESH] = (uint8_t)(v >> 2);
+                XC_REG[XC_ADRESL] = (uint8_t)(v << 6);
+            }
+            XC_QUITAR(ADCON0, XC_GO);
+            XC_PONER(PIR1, XC_ADIF);
+        }
+    }
+    if(!PRUEBA_EN_ISR && XC_BIT(PIR1, XC_ADIF) && XC_BIT(PIE1, XC_ADIE) &&
+       XC_BIT(INTCON, XC_PEIE) && XC_BIT(INTCON, XC_GIE)){
+        PRUEBA_EN_ISR = 1;
+        isr();
+        PRUEBA_EN_ISR = 0;
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * TIEMPO DE LA ISR
+ ------------------------------------------------------------------------------*/
+// Pseudorregistros de las tablas de tramos: entrada del hardware con el
+// guardado de contexto y restauracin con retfie
+#define TRAMO_ENTRADA XC_NUM_REGISTROS
+#define TRAMO_SALIDA (XC_NUM_REGISTROS + 1)
+#define TRAMO_FUERA (XC_NUM_REGISTROS + 2)  // CPU en el ciclo principal
+
+typedef struct {
+    uint8_t de;                 // Acceso (o TRAMO_ENTRADA) donde empieza el tramo
+    uint8_t a;                  // Acceso (o TRAMO_SALIDA) donde termina
+    uint8_t tcy;                // Peor caso de las ramas entre los dos
+} tramo_t;
+
+static unsigned PRUEBA_SIN_COSTO;   // Tramos que no estn en la tabla
+
+// Costo de la ISR entre dos accesos; un tramo que no est en la tabla es una
+// falla (la ISR cambi y hay que actualizar la tabla)
+static unsigned prueba_costo(const tramo_t *tabla, unsigned n, uint8_t de, uint8_t a){
+    unsigned i;
+
+    for(i = 0; i < n; i++){
+        if(tabla[i].de == de && tabla[i].a == a){
+            return tabla[i].tcy;
+        }
+    }
+    if(!PRUEBA_SIN_COSTO++){
+        printf("  FALLA: tramo %u -> %u sin costo en la tabla\n", de, a);
+        FALLAS++;
+    }
+    return 0;
+}
+
+#endif	/* PRUEBA_H */
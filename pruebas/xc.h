@@ -0,0 +1,172 @@
+/*
+ * File:   xc.h (pruebas)
+ * Author: Pablo Caal
+ *
+ * Sustituto de <xc.h> para compilar los programas en el host (gcc/cc)
+ *  - Cada SFR es un byte en XC_REG[]; el registro y sus bits (REGbits)
+ *    comparten la misma memoria, como en el PIC
+ *  - Todo acceso a un SFR pasa por xc_acceso(), que llama a XC_GANCHO (si
+ *    la prueba lo asign) con el registro accedido; as la prueba simula el
+ *    hardware: un byte SPI que llega a mitad de la ISR, la respuesta de un
+ *    esclavo, un SSP que no genera reloj, etc.
+ *  - _delay() y __delay_us() acumulan ciclos en XC_CICLOS en lugar de esperar
+ *  - TMR1 avanza un paso por acceso a SFR (XC_TMR1_POR_ACCESO) para que las
+ *    mediciones con TMR1 de los programas den un valor en el host; es una
+ *    cuenta de accesos a SFR, no de ciclos de instruccin
+ *
+ * Solo para las pruebas de pruebas/ (make pruebas), no forma parte del
+ * proyecto de MPLAB X. Los programas se incluyen con main renombrado a
+ * travs de pruebas/prueba.h.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef XC_H_PRUEBAS
+#define	XC_H_PRUEBAS
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ * REGISTROS
+ ------------------------------------------------------------------------------*/
+enum {
+    XC_PORTA, XC_PORTB, XC_PORTC, XC_PORTD, XC_PORTE,
+    XC_TRISA, XC_TRISB, XC_TRISC, XC_TRISD, XC_TRISE,
+    XC_ANSEL, XC_ANSELH, XC_SSPBUF, XC_SSPCON, XC_SSPSTAT,
+    XC_ADRESH, XC_ADRESL, XC_ADCON0, XC_ADCON1, XC_OSCCON,
+    XC_INTCON, XC_PIR1, XC_PIE1, XC_PIR2, XC_PIE2,
+    XC_T1CON, XC_TMR1L, XC_TMR1H, XC_CCPR1L, XC_CCPR1H, XC_CCP1CON,
+    XC_T2CON, XC_PR2, XC_TMR2, XC_TMR0, XC_OPTION_REG,
+    XC_WPUB, XC_IOCB, XC_WDTCON, XC_STATUS, XC_PCON,
+    XC_NUM_REGISTROS
+};
+
+volatile uint8_t XC_REG[XC_NUM_REGISTROS];     // Valor de cada SFR
+void (*XC_GANCHO)(uint8_t reg);                 // Hardware simulado por la prueba
+unsigned long XC_CICLOS;                        // Ciclos pedidos con _delay()
+uint8_t XC_TMR1_POR_ACCESO = 1;                 // Avance de TMR1L por acceso a SFR
+
+static volatile uint8_t *xc_acceso(uint8_t reg){
+    if(XC_TMR1_POR_ACCESO && reg != XC_TMR1L){
+        XC_REG[XC_TMR1L] += XC_TMR1_POR_ACCESO;
+    }
+    if(XC_GANCHO){
+        XC_GANCHO(reg);
+    }
+    return &XC_REG[reg];
+}
+
+#define XC_SFR(r)           (*xc_acceso(XC_##r))
+#define XC_BITS(t, r)       (*(volatile t *)xc_acceso(XC_##r))
+
+#define PORTA       XC_SFR(PORTA)
+#define PORTB       XC_SFR(PORTB)
+#define PORTC       XC_SFR(PORTC)
+#define PORTD       XC_SFR(PORTD)
+#define PORTE       XC_SFR(PORTE)
+#define TRISA       XC_SFR(TRISA)
+#define TRISB       XC_SFR(TRISB)
+#define TRISC       XC_SFR(TRISC)
+#define TRISD       XC_SFR(TRISD)
+#define TRISE       XC_SFR(TRISE)
+#define ANSEL       XC_SFR(ANSEL)
+#define ANSELH      XC_SFR(ANSELH)
+#define SSPBUF      XC_SFR(SSPBUF)
+#define SSPCON      XC_SFR(SSPCON)
+#define SSPSTAT     XC_SFR(SSPSTAT)
+#define ADRESH      XC_SFR(ADRESH)
+#define ADRESL      XC_SFR(ADRESL)
+#define ADCON0      XC_SFR(ADCON0)
+#define ADCON1      XC_SFR(ADCON1)
+#define OSCCON      XC_SFR(OSCCON)
+#define INTCON      XC_SFR(INTCON)
+#define PIR1        XC_SFR(PIR1)
+#define PIE1        XC_SFR(PIE1)
+#define PIR2        XC_SFR(PIR2)
+#define PIE2        XC_SFR(PIE2)
+#define T1CON       XC_SFR(T1CON)
+#define TMR1L       XC_SFR(TMR1L)
+#define TMR1H       XC_SFR(TMR1H)
+#define CCPR1L      XC_SFR(CCPR1L)
+#define CCPR1H      XC_SFR(CCPR1H)
+#define CCP1CON     XC_SFR(CCP1CON)
+#define T2CON       XC_SFR(T2CON)
+#define PR2         XC_SFR(PR2)
+#define TMR2        XC_SFR(TMR2)
+#define TMR0        XC_SFR(TMR0)
+#define OPTION_REG  XC_SFR(OPTION_REG)
+#define WPUB        XC_SFR(WPUB)
+#define IOCB        XC_SFR(IOCB)
+#define WDTCON      XC_SFR(WDTCON)
+#define STATUS      XC_SFR(STATUS)
+#define PCON        XC_SFR(PCON)
+
+/*------------------------------------------------------------------------------
+ * BITS DE REGISTROS
+ ------------------------------------------------------------------------------*/
+typedef struct { unsigned RA0:1, RA1:1, RA2:1, RA3:1, RA4:1, RA5:1, RA6:1, RA7:1; } xc_porta_t;
+typedef struct { unsigned RB0:1, RB1:1, RB2:1, RB3:1, RB4:1, RB5:1, RB6:1, RB7:1; } xc_portb_t;
+typedef struct { unsigned RC0:1, RC1:1, RC2:1, RC3:1, RC4:1, RC5:1, RC6:1, RC7:1; } xc_portc_t;
+typedef struct { unsigned TRISC0:1, TRISC1:1, TRISC2:1, TRISC3:1, TRISC4:1, TRISC5:1, TRISC6:1, TRISC7:1; } xc_trisc_t;
+typedef struct { unsigned RBIF:1, INTF:1, T0IF:1, RBIE:1, INTE:1, T0IE:1, PEIE:1, GIE:1; } xc_intcon_t;
+typedef struct { unsigned TMR1IF:1, TMR2IF:1, CCP1IF:1, SSPIF:1, TXIF:1, RCIF:1, ADIF:1, :1; } xc_pir1_t;
+typedef struct { unsigned TMR1IE:1, TMR2IE:1, CCP1IE:1, SSPIE:1, TXIE:1, RCIE:1, ADIE:1, :1; } xc_pie1_t;
+typedef struct { unsigned SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1; } xc_sspcon_t;
+typedef struct { unsigned BF:1, UA:1, R_nW:1, S:1, P:1, D_nA:1, CKE:1, SMP:1; } xc_sspstat_t;
+typedef struct { unsigned ADON:1, GO:1, CHS:4, ADCS:2; } xc_adcon0_t;
+typedef struct { unsigned :4, VCFG0:1, VCFG1:1, :1, ADFM:1; } xc_adcon1_t;
+typedef struct { unsigned SCS:1, LTS:1, HTS:1, OSTS:1, IRCF:3, :1; } xc_osccon_t;
+typedef struct { unsigned TMR1ON:1, TMR1CS:1, nT1SYNC:1, T1OSCEN:1, T1CKPS:2, TMR1GE:1, T1GINV:1; } xc_t1con_t;
+typedef struct { unsigned CCP1M:4, DC1B:2, P1M:2; } xc_ccp1con_t;
+typedef struct { unsigned SWDTEN:1, WDTPS:4, :3; } xc_wdtcon_t;
+typedef struct { unsigned C:1, DC:1, Z:1, nPD:1, nTO:1, RP:2, IRP:1; } xc_status_t;
+
+#define PORTAbits       XC_BITS(xc_porta_t, PORTA)
+#define PORTBbits       XC_BITS(xc_portb_t, PORTB)
+#define PORTCbits       XC_BITS(xc_portc_t, PORTC)
+#define TRISCbits       XC_BITS(xc_trisc_t, TRISC)
+#define INTCONbits      XC_BITS(xc_intcon_t, INTCON)
+#define PIR1bits        XC_BITS(xc_pir1_t, PIR1)
+#define PIE1bits        XC_BITS(xc_pie1_t, PIE1)
+#define SSPCONbits      XC_BITS(xc_sspcon_t, SSPCON)
+#define SSPSTATbits     XC_BITS(xc_sspstat_t, SSPSTAT)
+#define ADCON0bits      XC_BITS(xc_adcon0_t, ADCON0)
+#define ADCON1bits      XC_BITS(xc_adcon1_t, ADCON1)
+#define OSCCONbits      XC_BITS(xc_osccon_t, OSCCON)
+#define T1CONbits       XC_BITS(xc_t1con_t, T1CON)
+#define CCP1CONbits     XC_BITS(xc_ccp1con_t, CCP1CON)
+#define WDTCONbits      XC_BITS(xc_wdtcon_t, WDTCON)
+#define STATUSbits      XC_BITS(xc_status_t, STATUS)
+
+// Bits sueltos para el hardware simulado (sin pasar por el gancho)
+#define XC_BIT(r, b)        ((XC_REG[XC_##r] >> (b)) & 1)
+#define XC_PONER(r, b)      (XC_REG[XC_##r] |= (uint8_t)(1 << (b)))
+#define XC_QUITAR(r, b)     (XC_REG[XC_##r] &= (uint8_t)~(1 << (b)))
+#define XC_RBIF 0           // INTCON
+#define XC_RBIE 3           // INTCON
+#define XC_PEIE 6           // INTCON
+#define XC_GIE 7            // INTCON
+#define XC_CCP1IF 2         // PIR1
+#define XC_CCP1IE 2         // PIE1
+#define XC_SSPIF 3          // PIR1
+#define XC_SSPIE 3          // PIE1
+#define XC_ADIF 6           // PIR1
+#define XC_ADIE 6           // PIE1
+#define XC_GO 1             // ADCON0
+#define XC_ADFM 7           // ADCON1
+#define XC_BF 0             // SSPSTAT
+#define XC_SSPEN 5          // SSPCON
+#define XC_SSPOV 6          // SSPCON
+#define XC_WCOL 7           // SSPCON
+
+/*------------------------------------------------------------------------------
+ * COMPILADOR
+ ------------------------------------------------------------------------------*/
+#define __interrupt(...)
+#define _delay(x)           (XC_CICLOS += (unsigned long)(x))
+#define __delay_us(x)       (XC_CICLOS += (unsigned long)((x) * (_XTAL_FREQ / 4000000.0)))
+#define __delay_ms(x)       __delay_us((x) * 1000UL)
+#define CLRWDT()            ((void)0)
+#define NOP()               ((void)0)
+
+#endif	/* XC_H_PRUEBAS */
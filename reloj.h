@@ -0,0 +1,43 @@
+/*
+ * File:   reloj.h
+ * Author: Pablo Caal
+ *
+ * Perfil de reloj del oscilador interno (igual para los tres MCU)
+ *  RELOJ_MHZ = 1 -> perfil original del laboratorio
+ *  RELOJ_MHZ = 4 -> 4 veces ms ciclos por segundo
+ *  RELOJ_MHZ = 8 -> 8 veces ms ciclos por segundo (mximo del INTOSC)
+ *
+ * Se selecciona aqu o con -DRELOJ_MHZ=N. Todas las constantes de tiempo
+ * (IRCF, ADCS, divisor SPI, trama del servo) se derivan del perfil en
+ * perifericos.h; los retardos __delay_us/__delay_ms se ajustan solos con
+ * _XTAL_FREQ y los que dependen del otro MCU se expresan en ciclos.
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef RELOJ_H
+#define	RELOJ_H
+
+/*------------------------------------------------------------------------------
+ * CONSTANTES
+ ------------------------------------------------------------------------------*/
+#ifndef RELOJ_MHZ
+#define RELOJ_MHZ 1             // Perfil de reloj (1, 4 u 8 MHz)
+#endif
+
+#if RELOJ_MHZ != 1 && RELOJ_MHZ != 4 && RELOJ_MHZ != 8
+#error "RELOJ_MHZ debe ser 1, 4 u 8"
+#endif
+
+#define _XTAL_FREQ (RELOJ_MHZ * 1000000UL)  // Frecuencia de oscilador
+
+/*------------------------------------------------------------------------------
+ * MACROS
+ ------------------------------------------------------------------------------*/
+// Ciclos de instruccin (Fosc/4) en un tiempo en microsegundos
+#define US_A_CICLOS(us)     (((us) * 1UL * RELOJ_MHZ) / 4)
+
+// Duracin en nanosegundos de n periodos del oscilador (Tosc)
+#define TOSC_A_NS(n)        (((n) * 1000UL) / RELOJ_MHZ)
+
+#endif	/* RELOJ_H */
@@ -0,0 +1,82 @@
+/*
+ * File:   servo-protocolo.h
+ * Author: Pablo Caal
+ *
+ * Resolucin de la posicin del servo y modo de control entre el MCU1
+ * (master) y el MCU2 (esclavo 1). Ambos programas deben compilarse con los
+ * mismos valores.
+ *
+ *  SERVO_RESOLUCION = 8  -> ADRESH, un byte por actualizacin (mximo rendimiento)
+ *  SERVO_RESOLUCION = 10 -> ADRESH:ADRESL justificado a la derecha, dos bytes
+ *  SERVO_RESOLUCION = 12 -> 16 conversiones de 10 bits sobremuestreadas, dos bytes
+ *
+ * En 10 y 12 bits el valor viaja en dos bytes marcados para que el esclavo
+ * se resincronice solo si pierde uno:
+ *  Byte alto: 1xxxxxxx (bits 13-7)
+ *  Byte bajo: 0xxxxxxx (bits 6-0)
+ *
+ * LAZO_CERRADO = 1 -> el esclavo 1 controla la posicin con PI y responde en
+ *                     SSPBUF la posicin real (el master la muestra en PORTB)
+ * LAZO_CERRADO = 0 -> lazo abierto, el esclavo 1 no carga SSPBUF
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef SERVO_PROTOCOLO_H
+#define	SERVO_PROTOCOLO_H
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ * CONSTANTES
+ ------------------------------------------------------------------------------*/
+#ifndef SERVO_RESOLUCION
+#define SERVO_RESOLUCION 8      // Bits de la posicin (8, 10 o 12)
+#endif
+
+#if SERVO_RESOLUCION == 8
+#define SERVO_BYTES 1
+#elif SERVO_RESOLUCION == 10 || SERVO_RESOLUCION == 12
+#define SERVO_BYTES 2
+#else
+#error "SERVO_RESOLUCION debe ser 8, 10 o 12"
+#endif
+
+#ifndef LAZO_CERRADO
+#define LAZO_CERRADO 0          // Control PI en el esclavo 1 (1) o lazo abierto (0)
+#endif
+
+#define SERVO_MAX ((1u << SERVO_RESOLUCION) - 1)   // Valor mximo de la posicin
+#define SERVO_SOBREMUESTREO 16  // Conversiones por muestra en 12 bits (4^2 -> +2 bits)
+
+// Cota de peor caso del esclavo 1 desde que termina un byte hasta que su ISR
+// lee SSPBUF: el byte llega justo despus de revisar SSPIF y espera la rama
+// del CCP1 (flanco del servo, aritmtica de 16 bits), la del ADC en lazo
+// cerrado, la salida, la nueva entrada y el tramo con GIE apagado de
+// leer_referencia(). Con los costos por tramo de pruebas/prueba-isr-servo.c
+// (make pruebas, estimados del .lst) son 93 Tcy en lazo abierto y 149 en lazo
+// cerrado, ms 12 con GIE apagado: 161 Tcy, unos 140 de margen. Se confirma
+// con MEDIR_LATENCIA = 1 en postlab-slave1.c, igual que
+// SPI_LATENCIA_ESCLAVO_CICLOS (spi-maestro.h).
+#define SERVO_LATENCIA_ISR_CICLOS 300
+
+// Pausa del master entre el byte alto y el bajo: el byte bajo termina
+// 2 * SPI_DIVISOR ciclos despus de la pausa (8 bits a Fosc/SPI_DIVISOR) y el
+// esclavo debe haber ledo el byte alto antes, o se pierde con SSPOV.
+// SPI_DIVISOR viene de perifericos.h (solo se usa en el master).
+#define SERVO_PAUSA_CICLOS (SERVO_LATENCIA_ISR_CICLOS - 2 * SPI_DIVISOR)
+
+#define SERVO_MARCA_ALTO 0x80
+#define SERVO_BYTE_ALTO(v) ((uint8_t)(SERVO_MARCA_ALTO | ((v) >> 7)))
+#define SERVO_BYTE_BAJO(v) ((uint8_t)((v) & 0x7F))
+
+/*------------------------------------------------------------------------------
+ * TIPOS
+ ------------------------------------------------------------------------------*/
+#if SERVO_RESOLUCION == 8
+typedef uint8_t servo_t;
+#else
+typedef uint16_t servo_t;
+#endif
+
+#endif	/* SERVO_PROTOCOLO_H */
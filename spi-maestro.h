@@ -0,0 +1,194 @@
+/*
+ * File:   spi-maestro.h
+ * Author: Pablo Caal
+ *
+ * Transferencias SPI del maestro con tiempo de espera acotado
+ *  - Cada esclavo tiene su propio tiempo mximo de espera de BF
+ *  - Si BF no llega, el SSP propio est trabado: se reinicia el mdulo
+ *    (SSPEN 0 -> 1) y se cuenta un fallo del esclavo
+ *  - Despus de SPI_FALLOS_MAX fallos seguidos el esclavo se marca como
+ *    cado y se omite; cada SPI_REINTENTO ciclos se vuelve a probar
+ *
+ * BF llega despus de 8 pulsos de SCK haya o no un esclavo conectado, por lo
+ * que el tiempo de espera solo detecta la traba del SSP del maestro. Que el
+ * esclavo est vivo se juzga por su respuesta:
+ *  - spi_leer(): lectura verificada de dos bytes. El maestro enva SPI_LEER y
+ *    recibe el dato; el esclavo carga en su ISR el complemento del dato y el
+ *    maestro lo recibe al enviar SPI_VERIFICAR. Una lnea flotante (0xFF,
+ *    0xFF o 0x00, 0x00) o un esclavo que solo devuelve el eco del byte
+ *    anterior (0x55, 0xFF) no cumplen respuesta2 == ~respuesta1.
+ *  - spi_verificar(): el programa decide si una respuesta es vlida segn
+ *    su propio protocolo (p. ej. el eco del esclavo 1 en lazo abierto).
+ *  - spi_transferir(): sin verificacin, solo detecta la traba del SSP.
+ *  Un esclavo sin respuesta vlida cuenta como fallo igual que un timeout.
+ *
+ * El control de las lneas SS queda en cada programa. Debe incluirse despus
+ * de perifericos.h (usa SSPCON_MAESTRO_VALOR y SPI_DIVISOR).
+ *
+ * Inyeccin de fallas: SPI_INYECTAR_FALLA con el bit de un esclavo (campo id)
+ * apaga el SSP antes de su transferencia para que BF nunca llegue, as se
+ * prueba en simulacin el tiempo de espera, el reinicio y el estado de salud.
+ * Las fallas del esclavo (desconectado o trabado) se prueban en el host con
+ * pruebas/prueba-spi-maestro.c (make pruebas).
+ *
+ * Created on 19 de octubre de 2026
+ */
+
+#ifndef SPI_MAESTRO_H
+#define	SPI_MAESTRO_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ * CONSTANTES
+ ------------------------------------------------------------------------------*/
+#define SPI_OK 0                // Transferencia completa
+#define SPI_TIMEOUT 1           // BF no lleg a tiempo, SSP reiniciado
+#define SPI_SIN_RESPUESTA 2     // Respuesta invlida: esclavo ausente o trabado
+
+// Comandos de la lectura verificada (los esclavos comparan con su FLAG_SPI)
+#define SPI_LEER 0xFF           // Pide el dato; el esclavo carga su complemento
+#define SPI_VERIFICAR 0x55      // Recibe el complemento; el esclavo carga el siguiente dato
+
+#ifndef SPI_FALLOS_MAX
+#define SPI_FALLOS_MAX 3        // Fallos seguidos para marcar un esclavo como cado
+#endif
+#ifndef SPI_REINTENTO
+#define SPI_REINTENTO 50        // Ciclos entre reintentos a un esclavo cado
+#endif
+#ifndef SPI_INYECTAR_FALLA
+#define SPI_INYECTAR_FALLA 0    // Mscara de esclavos con falla simulada
+#endif
+
+// Cada vuelta de la espera de BF toma ~8 ciclos de instruccin y un byte toma
+// 2*SPI_DIVISOR ciclos (SPI_DIVISOR/4 vueltas). Se da 16 veces ese margen; al
+// estar en ciclos no depende del perfil de reloj (~2 ms a 1 MHz y Fosc/16).
+#define SPI_ESPERA_DEFECTO (SPI_DIVISOR < 64 ? SPI_DIVISOR * 4 : 255)
+
+// Tiempo con SS en alto para que el esclavo recargue SSPBUF en su ISR antes
+// de la siguiente lectura; en ciclos porque depende de la velocidad del esclavo
+#define SPI_GUARDA_SS_CICLOS 2500   // 10 ms a 1 MHz
+
+// Cota de peor caso de un esclavo contador (lab-slave, postlab-slave2) desde
+// que termina un byte hasta que su ISR recarga SSPBUF: un byte que llega justo
+// despus de revisar SSPIF espera una pasada completa por la rama de PORTB,
+// la salida y la nueva entrada a la ISR. Con los costos por tramo estimados
+// en pruebas/prueba-isr-esclavo.c (make pruebas) son 101 Tcy (81 hasta leer
+// SSPBUF) y la cota deja ~100 de margen. Esos costos no salen del listado del
+// programa actual; se confirma en simulacin con MEDIR_LATENCIA = 1,
+//  ISR_CICLOS_MAX + SSP_CICLOS_MAX + 2 * (entrada + contexto + salida) < cota
+// Se espera este tiempo entre los dos bytes de spi_leer() y despus del
+// segundo si sigue otro byte al mismo esclavo (lab-master.c).
+#define SPI_LATENCIA_ESCLAVO_CICLOS 200
+
+/*------------------------------------------------------------------------------
+ * TIPOS
+ ------------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t id;                 // Bit del esclavo (para inyeccin de fallas)
+    uint8_t espera_max;         // Vueltas mximas esperando BF
+    uint8_t fallos;             // Fallos seguidos
+    uint8_t reintento;          // Ciclos restantes para reintentar si est cado
+    uint16_t timeouts;          // Total de transferencias con el SSP trabado
+    uint16_t sin_respuesta;     // Total de respuestas invlidas del esclavo
+} spi_esclavo_t;
+
+// Inicializacin de un esclavo: {id, espera_max, 0, 0, 0, 0}
+#define SPI_ESCLAVO(id, espera)  {(id), (espera), 0, 0, 0, 0}
+
+/*------------------------------------------------------------------------------
+ * FUNCIONES
+ ------------------------------------------------------------------------------*/
+// Reinicio del SSP cuando el bus se traba
+static void spi_reiniciar(void){
+    uint8_t basura;
+    SSPCON = 0x00;                      // SSPEN = 0, limpia WCOL y SSPOV
+    SSPCON = SSPCON_MAESTRO_VALOR;      // SSPEN = 1 con la configuracin original
+    if(SSPSTATbits.BF){
+        basura = SSPBUF;                // Limpieza de BF
+        (void)basura;
+    }
+}
+
+// Fallo del esclavo (SSP trabado o respuesta invlida)
+static void spi_fallo(spi_esclavo_t *e){
+    if(e->fallos < SPI_FALLOS_MAX && ++e->fallos == SPI_FALLOS_MAX){
+        e->reintento = SPI_REINTENTO;   // Esclavo cado
+    }
+}
+
+// Se debe intentar comunicar con el esclavo en este ciclo?
+static uint8_t spi_disponible(spi_esclavo_t *e){
+    if(e->fallos < SPI_FALLOS_MAX){
+        return 1;
+    }
+    if(--e->reintento == 0){            // Esclavo cado: se prueba de nuevo cada SPI_REINTENTO ciclos
+        e->reintento = SPI_REINTENTO;
+        return 1;
+    }
+    return 0;
+}
+
+// Un byte con espera acotada, la respuesta queda en *rx. No cambia el estado
+// de salud si BF llega (eso lo decide quien verifica la respuesta)
+static uint8_t spi_byte(spi_esclavo_t *e, uint8_t tx, uint8_t *rx){
+    uint8_t espera = e->espera_max;
+
+#if SPI_INYECTAR_FALLA
+    if(SPI_INYECTAR_FALLA & e->id){
+        SSPCONbits.SSPEN = 0;           // Falla simulada: el SSP no genera reloj
+    }
+#endif
+    if(SSPSTATbits.BF){                 // Dato anterior sin leer (p. ej. el dato inicial de setup)
+        *rx = SSPBUF;
+    }
+    SSPBUF = tx;                        // Master inicia la comunicacin y prende el clock
+    while(!SSPSTATbits.BF){             // Esperamos a que termine el envio
+        if(--espera == 0){
+            spi_reiniciar();
+            e->timeouts++;
+            spi_fallo(e);
+            return SPI_TIMEOUT;
+        }
+    }
+    *rx = SSPBUF;                       // Lectura de la respuesta (limpia BF)
+    return SPI_OK;
+}
+
+// Resultado de una respuesta ya recibida: vlida -> esclavo sano
+static uint8_t spi_verificar(spi_esclavo_t *e, uint8_t valida){
+    if(valida){
+        e->fallos = 0;
+        return SPI_OK;
+    }
+    e->sin_respuesta++;
+    spi_fallo(e);
+    return SPI_SIN_RESPUESTA;
+}
+
+// Transferencia de un byte sin verificar la respuesta (solo detecta la traba
+// del SSP propio, un esclavo ausente no se nota)
+static uint8_t spi_transferir(spi_esclavo_t *e, uint8_t tx, uint8_t *rx){
+    if(spi_byte(e, tx, rx) != SPI_OK){
+        return SPI_TIMEOUT;
+    }
+    e->fallos = 0;
+    return SPI_OK;
+}
+
+// Lectura verificada: SPI_LEER -> dato, SPI_VERIFICAR -> ~dato
+static uint8_t spi_leer(spi_esclavo_t *e, uint8_t *dato){
+    uint8_t complemento;
+
+    if(spi_byte(e, SPI_LEER, dato) != SPI_OK){
+        return SPI_TIMEOUT;
+    }
+    _delay(SPI_LATENCIA_ESCLAVO_CICLOS);    // El esclavo carga ~dato en su ISR
+    if(spi_byte(e, SPI_VERIFICAR, &complemento) != SPI_OK){
+        return SPI_TIMEOUT;
+    }
+    return spi_verificar(e, (complemento ^ *dato) == 0xFF);
+}
+
+#endif	/* SPI_MAESTRO_H */